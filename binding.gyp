@@ -12,6 +12,8 @@
                 "napi/algorithms/onedirection.cpp",
                 "napi/algorithms/dog.cpp",
                 "napi/algorithms/sim.cpp",
+                "napi/algorithms/mcts.cpp",
+                "napi/algorithms/paranoid.cpp",
                 "napi/algorithms/inyourface.cpp",
                 "napi/test/testsuite.cpp",
                 "napi/interop.cpp",
@@ -20,6 +22,17 @@
                 "napi/movement.cpp",
                 "napi/simulator.cpp",
                 "napi/timing.cpp",
+                "napi/zobrist.cpp",
+                "napi/transposition.cpp",
+                "napi/rollout.cpp",
+                "napi/log.cpp",
+                "napi/features.cpp",
+                "napi/matrixgame.cpp",
+                "napi/bitboard.cpp",
+                "napi/voronoi.cpp",
+                "napi/evaluator.cpp",
+                "napi/leaf.cpp",
+                "napi/patterns.cpp",
                 "napi/benchmark/benchsuite.cpp"
             ],
             "cflags_cc": [
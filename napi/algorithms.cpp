@@ -7,6 +7,8 @@
 #include "algorithms/inyourface.hpp"
 #include "algorithms/random.hpp"
 #include "algorithms/onedirection.hpp"
+#include "algorithms/mcts.hpp"
+#include "algorithms/paranoid.hpp"
 
 Algorithms Algorithms::_instance;
 
@@ -16,7 +18,10 @@ Algorithms::Algorithms()
     _algorithms["hungry"] = std::make_unique<Hungry>();
     _algorithms["terminator"] = std::make_unique<Terminator>();
     _algorithms["dog"] = std::make_unique<Dog>();
-    _algorithms["sim"] = std::make_unique<Sim>();
+    _algorithms["sim"] = std::make_unique<Sim>(10000, 120, true);
+    _algorithms["sim_horizon"] = std::make_unique<Sim>(SIM_HORIZON_TURNS, 120, true, true);
+    _algorithms["mcts"] = std::make_unique<Mcts>();
+    _algorithms["paranoid"] = std::make_unique<Paranoid>();
     _algorithms["inyourface"] = std::make_unique<InYourFace>();
     _algorithms["random"] = std::make_unique<Random>();
     _algorithms["onedirection_left"] = std::make_unique<OneDirection>(Direction::Left);
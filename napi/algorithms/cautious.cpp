@@ -1,5 +1,5 @@
 #include "cautious.hpp"
-#include "../movement.hpp"
+#include "../policy.hpp"
 #include "../astar.hpp"
 
 #include <functional>
@@ -24,18 +24,5 @@ void Cautious::start(std::string /*id*/)
 
 Direction Cautious::move(GameState &state)
 {
-    auto foodDir = bestFood(state);
-    if (foodDir.hasValue)
-    {
-        return foodDir.value;
-    }
-
-    auto chaseDir = chaseTail(state);
-    if (chaseDir.hasValue)
-    {
-        return chaseDir.value;
-    }
-
-    auto alt = notImmediatelySuicidal(state);
-    return alt.value;
+    return policyMove<CautiousPolicy>(state);
 }
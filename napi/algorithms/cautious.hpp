@@ -8,4 +8,5 @@ public:
     Metadata meta() override;
     Direction move(GameState &state) override;
     void start(std::string id) override;
+    PolicyKind policyKind() override { return PolicyKind::Cautious; }
 };
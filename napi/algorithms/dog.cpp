@@ -1,5 +1,5 @@
 #include "dog.hpp"
-#include "../movement.hpp"
+#include "../policy.hpp"
 #include "../astar.hpp"
 
 #include <functional>
@@ -24,13 +24,5 @@ void Dog::start(std::string /*id*/)
 
 Direction Dog::move(GameState &state)
 {
-
-    auto chaseDir = chaseTail(state);
-    if (chaseDir.hasValue)
-    {
-        return chaseDir.value;
-    }
-
-    auto alt = notImmediatelySuicidal(state);
-    return alt.value;
+    return policyMove<DogPolicy>(state);
 }
@@ -1,5 +1,5 @@
 #include "hungry.hpp"
-#include "../movement.hpp"
+#include "../policy.hpp"
 #include "../astar.hpp"
 
 #include <functional>
@@ -24,12 +24,5 @@ void Hungry::start(std::string /*id*/)
 
 Direction Hungry::move(GameState &state)
 {
-    auto foodDir = closestFood(state);
-    if (foodDir.hasValue)
-    {
-        return foodDir.value;
-    }
-
-    auto alt = notImmediatelySuicidal(state);
-    return alt.value;
+    return policyMove<HungryPolicy>(state);
 }
@@ -0,0 +1,512 @@
+#include "mcts.hpp"
+#include "../simulator.hpp"
+#include "../rollout.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <cmath>
+
+// Number of nodes the tree can hold. Once they're used up the search keeps
+// going but the tree stops growing.
+#define MCTS_NODE_POOL_SIZE 20000
+
+// Exploration constant for UCT.
+#define MCTS_EXPLORATION 1.0
+
+// Rewards are summed as fixed point integers so that they can be atomic.
+#define MCTS_VALUE_SCALE 1000000
+
+// Time kept back from the deadline for picking the move and replying.
+#define MCTS_SCORING_RESERVE_MILLIS 10
+
+// How long past the deadline the search threads get before being cancelled.
+#define MCTS_GRACE_MILLIS 5
+
+#define NO_SNAKE -1
+
+// Direction index (same order as the Direction enum) for each snake slot or
+// NO_SNAKE if that snake isn't alive.
+typedef std::array<int8_t, MAX_SNAKES> JointMove;
+
+struct MctsNode
+{
+    World world;
+    bool terminal;
+    uint32_t depth;
+
+    // Index into world.snakes for each slot or NO_SNAKE if it's dead.
+    std::array<int8_t, MAX_SNAKES> snakeIndex;
+
+    // Bit mask of directions each slot can move without hitting a wall or
+    // body.
+    std::array<uint8_t, MAX_SNAKES> legal;
+
+    // Visits are added as soon as a thread picks a move (virtual loss) and the
+    // reward only shows up once its playout is done. That keeps the other
+    // threads from all piling onto the same line.
+    std::atomic<uint32_t> visits;
+    std::array<std::array<std::atomic<uint32_t>, 4>, MAX_SNAKES> actionVisits;
+    std::array<std::array<std::atomic<int64_t>, 4>, MAX_SNAKES> actionValue;
+
+    std::mutex childMutex;
+    std::vector<std::pair<uint32_t, MctsNode *>> children;
+};
+
+typedef std::array<double, MAX_SNAKES> Rewards;
+
+// Shared pool of nodes. Snakes are identified by slot, which is their index in
+// the root state, so that the statistics line up as snakes die off.
+class MctsTree
+{
+public:
+    MctsTree() : _nodes(MCTS_NODE_POOL_SIZE), _nextNode(0)
+    { }
+
+    void reset(World &rootWorld)
+    {
+        slotIds.clear();
+        mySlot = 0;
+        for (Snake &snake : rootWorld.snakes)
+        {
+            if (snake.id == rootWorld.you)
+            {
+                mySlot = slotIds.size();
+            }
+            slotIds.push_back(snake.id);
+        }
+
+        iterations = 0;
+        maxDepth = 0;
+        _nextNode = 1;
+        initNode(_nodes[0], rootWorld, 0);
+    }
+
+    MctsNode *root()
+    {
+        return &_nodes[0];
+    }
+
+    // Returns nullptr once the pool is used up.
+    MctsNode *allocate()
+    {
+        uint32_t index = _nextNode++;
+        return index < _nodes.size() ? &_nodes[index] : nullptr;
+    }
+
+    uint32_t nodeCount()
+    {
+        return std::min<uint32_t>(_nextNode, _nodes.size());
+    }
+
+    int slotOf(std::string &id)
+    {
+        for (size_t i = 0; i < slotIds.size(); i++)
+        {
+            if (slotIds[i] == id)
+                return i;
+        }
+        return NO_SNAKE;
+    }
+
+    void initNode(MctsNode &node, World world, uint32_t depth)
+    {
+        node.world = std::move(world);
+        node.depth = depth;
+        node.snakeIndex.fill(NO_SNAKE);
+        node.legal.fill(0);
+        node.visits = 0;
+        for (size_t s = 0; s < MAX_SNAKES; s++)
+        {
+            for (size_t a = 0; a < 4; a++)
+            {
+                node.actionVisits[s][a] = 0;
+                node.actionValue[s][a] = 0;
+            }
+        }
+        node.children.clear();
+
+        GameState state(node.world);
+        for (size_t i = 0; i < node.world.snakes.size(); i++)
+        {
+            Snake &snake = node.world.snakes[i];
+            int slot = slotOf(snake.id);
+            if (slot == NO_SNAKE)
+                continue;
+
+            node.snakeIndex[slot] = i;
+            node.legal[slot] = legalMoves(state, snake);
+        }
+
+        // Over once I'm dead or nobody is left to beat.
+        node.terminal = node.snakeIndex[mySlot] == NO_SNAKE
+            || node.world.snakes.size() <= 1;
+
+        updateMaxDepth(depth);
+    }
+
+    void updateMaxDepth(uint32_t depth)
+    {
+        uint32_t current = maxDepth;
+        while (depth > current && !maxDepth.compare_exchange_weak(current, depth))
+        { }
+    }
+
+    std::vector<std::string> slotIds;
+    uint32_t mySlot;
+    std::atomic<uint32_t> iterations;
+    std::atomic<uint32_t> maxDepth;
+
+private:
+    uint8_t legalMoves(GameState &state, Snake &snake)
+    {
+        uint8_t mask = 0;
+        Point head = snake.head();
+        for (uint8_t a = 0; a < 4; a++)
+        {
+            Point p = coordAfterMove(head, static_cast<Direction>(a));
+            bool isNeck = snake.length() > 1 && snake.parts.at(1) == p;
+            if (!outOfBounds(p, state)
+                && state.map().turnsUntilVacant(p) == 0
+                && !isNeck)
+            {
+                mask |= 1 << a;
+            }
+        }
+
+        // It's dead whichever way it goes so don't bother branching on it.
+        return mask == 0 ? 1 : mask;
+    }
+
+    std::vector<MctsNode> _nodes;
+    std::atomic<uint32_t> _nextNode;
+};
+
+uint32_t jointMoveKey(JointMove &moves)
+{
+    uint32_t key = 0;
+    for (size_t s = 0; s < MAX_SNAKES; s++)
+    {
+        if (moves[s] != NO_SNAKE)
+        {
+            key |= static_cast<uint32_t>(moves[s]) << (2 * s);
+        }
+    }
+    return key;
+}
+
+JointMove selectMoves(MctsTree &tree, MctsNode &node)
+{
+    JointMove moves;
+    moves.fill(NO_SNAKE);
+    double logVisits = std::log(node.visits + 1.0);
+
+    for (size_t s = 0; s < tree.slotIds.size(); s++)
+    {
+        if (node.snakeIndex[s] == NO_SNAKE)
+            continue;
+
+        int best = NO_SNAKE;
+        double bestScore = 0.0;
+        for (int a = 0; a < 4; a++)
+        {
+            if (!(node.legal[s] & (1 << a)))
+                continue;
+
+            uint32_t n = node.actionVisits[s][a];
+            double score = n == 0
+                ? 1e9
+                : static_cast<double>(node.actionValue[s][a]) / MCTS_VALUE_SCALE / n
+                    + MCTS_EXPLORATION * std::sqrt(logVisits / n);
+
+            if (best == NO_SNAKE || score > bestScore)
+            {
+                best = a;
+                bestScore = score;
+            }
+        }
+
+        moves[s] = best;
+        node.actionVisits[s][best]++;
+    }
+
+    node.visits++;
+    return moves;
+}
+
+World worldAfterMoves(MctsNode &node, JointMove &moves)
+{
+    World next = node.world;
+    std::vector<SnakeMove> snakeMoves;
+    for (size_t s = 0; s < MAX_SNAKES; s++)
+    {
+        if (moves[s] != NO_SNAKE)
+        {
+            snakeMoves.push_back({
+                &next.snakes[node.snakeIndex[s]],
+                static_cast<Direction>(moves[s])
+            });
+        }
+    }
+    applyMoves(next, snakeMoves);
+    return next;
+}
+
+// Finds the child for this joint move, creating it if it doesn't exist yet.
+// Returns nullptr if the pool is out of nodes.
+MctsNode *childFor(
+    MctsTree &tree, MctsNode &node, JointMove &moves, bool &created)
+{
+    uint32_t key = jointMoveKey(moves);
+    std::lock_guard<std::mutex> lock(node.childMutex);
+
+    for (auto &pair : node.children)
+    {
+        if (pair.first == key)
+        {
+            created = false;
+            return pair.second;
+        }
+    }
+
+    MctsNode *child = tree.allocate();
+    if (child == nullptr)
+    {
+        return nullptr;
+    }
+
+    tree.initNode(*child, worldAfterMoves(node, moves), node.depth + 1);
+    node.children.push_back({ key, child });
+    created = true;
+    return child;
+}
+
+Rewards terminalRewards(MctsTree &tree, World &world)
+{
+    Rewards rewards;
+    rewards.fill(0.0);
+    for (Snake &snake : world.snakes)
+    {
+        int slot = tree.slotOf(snake.id);
+        if (slot != NO_SNAKE)
+        {
+            rewards[slot] = 1.0;
+        }
+    }
+    return rewards;
+}
+
+// Plays out up to `depth` turns with cheapRolloutMove() for every snake, the
+// same policy the simulator uses past its first few turns. Anything that
+// searches its own perspective (eg: the policies in policy.hpp) costs so much
+// per turn that only a handful of iterations fit in the time. Surviving is
+// worth 1 and dying is worth up to 0.5 depending on how long the snake
+// lasted.
+Rewards rollout(
+    MctsTree &tree,
+    World &world,
+    uint32_t depth,
+    FoodDistanceField &field)
+{
+    std::array<uint32_t, MAX_SNAKES> deathTurn;
+    deathTurn.fill(0);
+
+    std::unique_ptr<GameState> state(new GameState(world));
+    uint32_t turn = 0;
+    while (turn < depth && !state->isLoss() && !state->enemies().empty())
+    {
+        turn++;
+        field.update(*state);
+        std::vector<SnakeMove> moves {
+            { state->mySnake(), cheapRolloutMove(*state, state->mySnake(), field) }
+        };
+
+        for (Snake *enemy : state->enemies())
+        {
+            moves.push_back({ enemy, cheapRolloutMove(*state, enemy, field) });
+        }
+
+        std::unique_ptr<GameState> next = state->newStateAfterMoves(moves);
+        for (auto &pair : state->snakes())
+        {
+            if (next->snakes().find(pair.first) == next->snakes().end())
+            {
+                int slot = tree.slotOf(pair.second->id);
+                if (slot != NO_SNAKE)
+                {
+                    deathTurn[slot] = turn;
+                }
+            }
+        }
+        state = std::move(next);
+    }
+
+    Rewards rewards;
+    rewards.fill(0.0);
+    for (Snake &snake : world.snakes)
+    {
+        int slot = tree.slotOf(snake.id);
+        if (slot == NO_SNAKE)
+            continue;
+
+        rewards[slot] = deathTurn[slot] == 0
+            ? 1.0
+            : 0.5 * deathTurn[slot] / depth;
+    }
+    return rewards;
+}
+
+void iterate(
+    MctsTree &tree,
+    uint32_t rolloutDepth,
+    FoodDistanceField &field)
+{
+    std::vector<std::pair<MctsNode *, JointMove>> path;
+    MctsNode *node = tree.root();
+    Rewards rewards;
+
+    while (true)
+    {
+        if (node->terminal)
+        {
+            rewards = terminalRewards(tree, node->world);
+            break;
+        }
+
+        JointMove moves = selectMoves(tree, *node);
+        path.push_back({ node, moves });
+
+        bool created = false;
+        MctsNode *child = childFor(tree, *node, moves, created);
+        if (child == nullptr)
+        {
+            // Out of nodes so just play out from here without growing the tree.
+            World next = worldAfterMoves(*node, moves);
+            GameState nextState(next);
+            rewards = nextState.isLoss() || next.snakes.size() <= 1
+                ? terminalRewards(tree, next)
+                : rollout(tree, next, rolloutDepth, field);
+            break;
+        }
+
+        if (created)
+        {
+            rewards = child->terminal
+                ? terminalRewards(tree, child->world)
+                : rollout(tree, child->world, rolloutDepth, field);
+            break;
+        }
+
+        node = child;
+    }
+
+    for (auto &step : path)
+    {
+        MctsNode *pathNode = step.first;
+        JointMove &moves = step.second;
+        for (size_t s = 0; s < MAX_SNAKES; s++)
+        {
+            if (moves[s] != NO_SNAKE)
+            {
+                pathNode->actionValue[s][moves[s]] +=
+                    static_cast<int64_t>(rewards[s] * MCTS_VALUE_SCALE);
+            }
+        }
+    }
+
+    tree.iterations++;
+}
+
+Mcts::Mcts() : _maxMillis(120), _rolloutDepth(40), _lastStats({ 0, 0, 0 })
+{ }
+
+Mcts::Mcts(uint32_t maxMillis, uint32_t rolloutDepth) :
+    _maxMillis(maxMillis), _rolloutDepth(rolloutDepth), _lastStats({ 0, 0, 0 })
+{ }
+
+// Defined here where MctsTree is a complete type.
+Mcts::~Mcts()
+{ }
+
+Metadata Mcts::meta()
+{
+    return {
+        "#4b0082",
+        "#FFFFFF",
+        "https://upload.wikimedia.org/wikipedia/commons/thumb/a/a1/MCTS-steps.svg/808px-MCTS-steps.svg.png",
+        "Monte Carlo",
+        "Rolling the dice",
+        "pixel",
+        "pixel"
+    };
+}
+
+void Mcts::start(std::string /*id*/)
+{
+    SimThread::startAll();
+}
+
+Direction Mcts::move(GameState &state)
+{
+    return move(state, Deadline::fromNow(_maxMillis + MCTS_SCORING_RESERVE_MILLIS));
+}
+
+Direction Mcts::move(GameState &state, const Deadline &deadline)
+{
+    // Slots are packed into fixed size arrays and there's nobody to search
+    // against when alone.
+    if (state.world().snakes.size() > MAX_SNAKES || state.enemies().empty())
+    {
+        return _cautious.move(state);
+    }
+
+    SimThread::startAll();
+
+    if (!_tree)
+    {
+        _tree = std::make_unique<MctsTree>();
+    }
+
+    MctsTree &tree = *_tree;
+    tree.reset(state.world());
+
+    Deadline searchDeadline = deadline
+        .reserve(MCTS_SCORING_RESERVE_MILLIS)
+        .earliest(Deadline::fromNow(_maxMillis));
+    uint32_t rolloutDepth = _rolloutDepth;
+
+    SimulationHandle search = runOnSimThreadsAsync(
+        [&tree, searchDeadline, rolloutDepth](
+            uint32_t /*thread*/, std::atomic<bool> &cancelled)
+        {
+            FoodDistanceField field;
+            do
+            {
+                iterate(tree, rolloutDepth, field);
+            }
+            while (!searchDeadline.expired() && !cancelled);
+        });
+
+    if (!search.waitUntil(searchDeadline.extend(MCTS_GRACE_MILLIS).at()))
+    {
+        search.cancel();
+    }
+    search.get();
+
+    MctsNode *root = tree.root();
+    uint32_t mySlot = tree.mySlot;
+    int best = NO_SNAKE;
+    for (int a = 0; a < 4; a++)
+    {
+        if (!(root->legal[mySlot] & (1 << a)))
+            continue;
+
+        if (best == NO_SNAKE
+            || root->actionVisits[mySlot][a] > root->actionVisits[mySlot][best])
+        {
+            best = a;
+        }
+    }
+
+    _lastStats = { tree.iterations, tree.nodeCount(), tree.maxDepth };
+    return static_cast<Direction>(best);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../snakelib.hpp"
+#include "cautious.hpp"
+
+class MctsTree;
+
+struct MctsStats
+{
+    uint32_t iterations;
+    uint32_t nodes;
+    uint32_t maxDepth;
+};
+
+// Monte Carlo tree search over simultaneous moves. Every snake picks its own
+// move at each node with UCT on its own statistics (decoupled UCT) and the
+// joint move leads to the child. Leaves are scored by rolling out with
+// cheapRolloutMove() for every snake. All the SimThreads search the same tree
+// at once.
+class Mcts : public Algorithm
+{
+public:
+    Mcts();
+    Mcts(uint32_t maxMillis, uint32_t rolloutDepth);
+    ~Mcts();
+    Metadata meta() override;
+    Direction move(GameState &state) override;
+    Direction move(GameState &state, const Deadline &deadline) override;
+    void start(std::string id) override;
+
+    MctsStats lastStats() { return _lastStats; }
+
+private:
+    uint32_t _maxMillis;
+    uint32_t _rolloutDepth;
+    std::unique_ptr<MctsTree> _tree;
+    MctsStats _lastStats;
+    Cautious _cautious;
+};
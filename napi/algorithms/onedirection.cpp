@@ -3,11 +3,9 @@
 #include "../movement.hpp"
 #include "../astar.hpp"
 
-#include <functional>
-#include <unordered_map>
-#include <sstream>
-
-std::unordered_map<std::string, bool> OneDirection::_finishMap;
+// Policy state word that gets set once the snake can't keep going in its
+// direction anymore.
+#define FINISHED_WORD 0
 
 OneDirection::OneDirection(Direction direction) : _direction(direction)
 { }
@@ -37,7 +35,7 @@ Metadata OneDirection::meta()
 
 void OneDirection::start(std::string id)
 {
-    _finishMap[id] = false;
+    _games[id] = {};
 }
 
 MaybeDirection tryMove(Direction direction, GameState &state)
@@ -54,33 +52,26 @@ MaybeDirection tryMove(Direction direction, GameState &state)
 
 Direction OneDirection::move(GameState &state)
 {
-    return move(state, 0);
+    // Creates the game's state if start() was missed (eg: the server
+    // restarted in the middle of a game).
+    return move(state, _games[state.gameId()]);
 }
 
-Direction OneDirection::move(GameState &state, uint32_t branchId)
+Direction OneDirection::move(GameState &state, PolicyState &policyState)
 {
-    std::stringstream ss;
-    ss << state.gameId() << "_" << branchId;
-    std::string key = ss.str();
-
     // If already finished moving in this direction then switch to cautious.
-    auto finishIter = _finishMap.find(key);
-    if (finishIter != _finishMap.end() && finishIter->second)
+    if (policyState.words[FINISHED_WORD])
     {
         Cautious cautious;
         return cautious.move(state);
     }
 
-    // Should already be in the dictionary from call to start() but just make
-    // sure in case server restarts or something.
-    _finishMap[key] = false;
-
     // Try to move in specified direction.
     MaybeDirection attempt = tryMove(_direction, state);
     if (attempt.hasValue) return attempt.value;
 
     // Can't move in this direction anymore so change to backup algorithm.
-    _finishMap[key] = true;
+    policyState.words[FINISHED_WORD] = 1;
     Cautious cautious;
     return cautious.move(state);
 }
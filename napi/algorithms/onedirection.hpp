@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../snakelib.hpp"
+#include <unordered_map>
 
 class OneDirection : public Algorithm
 {
@@ -8,11 +9,14 @@ public:
     OneDirection(Direction direction);
     Metadata meta() override;
     Direction move(GameState &state) override;
-    Direction move(GameState &state, uint32_t branchId) override;
+    Direction move(GameState &state, PolicyState &policyState) override;
     void start(std::string id) override;
+    bool hasBranchState() override { return true; }
 
 private:
     Direction _direction;
 
-    static std::unordered_map<std::string, bool> _finishMap;
+    // State for real games, where there's no simulation to own it. By game
+    // id since the same instance plays every game on the server.
+    std::unordered_map<std::string, PolicyState> _games;
 };
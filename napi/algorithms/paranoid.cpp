@@ -0,0 +1,440 @@
+#include "paranoid.hpp"
+#include "../transposition.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+// Score for a decided game. Wins/losses are adjusted by ply so that quicker
+// wins and slower losses are preferred.
+#define PARANOID_WIN 1000000
+#define PARANOID_INFINITY (PARANOID_WIN + 1)
+
+#define PARANOID_MAX_DEPTH 64
+
+// Scores past this are decided games rather than evaluations (with room for
+// the ply adjustments at any depth).
+#define PARANOID_DECIDED (PARANOID_WIN - 2 * PARANOID_MAX_DEPTH)
+
+// Static evaluator weights.
+#define PARANOID_SPACE_WEIGHT 10
+#define PARANOID_LENGTH_WEIGHT 30
+#define PARANOID_FOOD_WEIGHT 2
+#define PARANOID_STARVING_PENALTY 5000
+
+// Number of nodes between checks of the clock.
+#define PARANOID_TIME_CHECK_INTERVAL 64
+
+// Time kept back from the deadline for replying.
+#define PARANOID_SCORING_RESERVE_MILLIS 10
+
+// Mixed into state hashes so that entries in the shared transposition table
+// don't get mixed up with anyone else's.
+#define PARANOID_TABLE_SALT 0x9e3779b97f4a7c15ULL
+
+// Scores are within +-PARANOID_INFINITY so 24 bits is plenty, which leaves
+// the whole entry well inside the table's TRANSPOSITION_DATA_BITS.
+uint64_t packEntry(ParanoidEntry entry)
+{
+    return (static_cast<uint32_t>(entry.score) & 0xFFFFFF)
+        | static_cast<uint64_t>(entry.depth & 0xFF) << 24
+        | static_cast<uint64_t>(entry.bound) << 32
+        | static_cast<uint64_t>(entry.bestMove) << 34;
+}
+
+ParanoidEntry unpackEntry(uint64_t data)
+{
+    return {
+        static_cast<uint32_t>((data >> 24) & 0xFF),
+        static_cast<int32_t>(static_cast<uint32_t>(data) << 8) >> 8,
+        static_cast<ParanoidBound>((data >> 32) & 0x3),
+        static_cast<Direction>((data >> 34) & 0x3)
+    };
+}
+
+// Decided scores count plies from the root, which depends on how the search
+// got to a position. The table keeps them as plies from the position itself
+// so an entry means the same thing wherever it turns up.
+int32_t scoreToTable(int32_t score, uint32_t ply)
+{
+    if (score >= PARANOID_DECIDED)
+        return score + static_cast<int32_t>(ply);
+    if (score <= -PARANOID_DECIDED)
+        return score - static_cast<int32_t>(ply);
+    return score;
+}
+
+int32_t scoreFromTable(int32_t score, uint32_t ply)
+{
+    if (score >= PARANOID_DECIDED)
+        return score - static_cast<int32_t>(ply);
+    if (score <= -PARANOID_DECIDED)
+        return score + static_cast<int32_t>(ply);
+    return score;
+}
+
+std::vector<Direction> legalDirections(GameState &state, Snake *snake)
+{
+    std::vector<Direction> result;
+    Point head = snake->head();
+    for (Direction dir : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+    {
+        Point p = coordAfterMove(head, dir);
+        bool isNeck = snake->length() > 1 && snake->parts.at(1) == p;
+        if (!outOfBounds(p, state)
+            && state.map().turnsUntilVacant(p) == 0
+            && !isNeck)
+        {
+            result.push_back(dir);
+        }
+    }
+    return result;
+}
+
+// Same idea as countAccessibleCellsAfterMove() but over every first move at
+// once and without the hash set.
+int32_t reachableCells(GameState &state, Snake *snake)
+{
+    std::vector<bool> seen(state.width() * state.height(), false);
+    std::vector<std::pair<Point, uint32_t>> queue;
+    int32_t count = 0;
+
+    Point head = snake->head();
+    for (Direction dir : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+    {
+        queue.push_back({ coordAfterMove(head, dir), 0 });
+    }
+
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        Point p = queue[i].first;
+        uint32_t turn = queue[i].second;
+
+        if (outOfBounds(p, state))
+            continue;
+
+        uint32_t index = cellIndex(p, state);
+        if (seen[index])
+            continue;
+
+        seen[index] = true;
+        if (turn < state.map().turnsUntilVacant(p))
+            continue;
+
+        count++;
+        for (Direction dir : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+        {
+            queue.push_back({ coordAfterMove(p, dir), turn + 1 });
+        }
+    }
+
+    return count;
+}
+
+int32_t evaluate(GameState &state)
+{
+    Snake *me = state.mySnake();
+    int32_t enemySpace = 0;
+    int32_t enemyLength = 0;
+    for (Snake *enemy : state.enemies())
+    {
+        enemySpace = std::max(enemySpace, reachableCells(state, enemy));
+        enemyLength = std::max(enemyLength, static_cast<int32_t>(enemy->length()));
+    }
+
+    int32_t mySpace = reachableCells(state, me);
+    int32_t myLength = me->length();
+    int32_t score = PARANOID_SPACE_WEIGHT * (mySpace - enemySpace)
+        + PARANOID_LENGTH_WEIGHT * (myLength - enemyLength);
+
+    if (!state.food().empty())
+    {
+        uint32_t closest = UINT32_MAX;
+        for (Point food : state.food())
+        {
+            closest = std::min(closest, distance(me->head(), food));
+        }
+
+        score -= PARANOID_FOOD_WEIGHT * closest;
+        if (me->health < closest)
+        {
+            score -= PARANOID_STARVING_PENALTY;
+        }
+    }
+
+    return score;
+}
+
+Paranoid::Paranoid() : Paranoid(120)
+{ }
+
+Paranoid::Paranoid(uint32_t maxMillis) :
+    _maxMillis(maxMillis), _aborted(false), _stats({ 0, 0, 0 })
+{ }
+
+Metadata Paranoid::meta()
+{
+    return {
+        "#2f4f4f",
+        "#FFFFFF",
+        "https://upload.wikimedia.org/wikipedia/commons/thumb/9/91/AB_pruning.svg/1212px-AB_pruning.svg.png",
+        "Paranoid",
+        "Everyone is out to get me",
+        "pixel",
+        "pixel"
+    };
+}
+
+void Paranoid::start(std::string /*id*/)
+{
+}
+
+Direction Paranoid::move(GameState &state)
+{
+    return move(state, Deadline::fromNow(_maxMillis + PARANOID_SCORING_RESERVE_MILLIS));
+}
+
+Direction Paranoid::move(GameState &state, const Deadline &deadline)
+{
+    std::vector<Direction> moves = legalDirections(state, state.mySnake());
+    if (state.enemies().empty() || moves.empty())
+    {
+        return _cautious.move(state);
+    }
+
+    _deadline = deadline
+        .reserve(PARANOID_SCORING_RESERVE_MILLIS)
+        .earliest(Deadline::fromNow(_maxMillis));
+    _aborted = false;
+    _stats = { 0, 0, 0 };
+
+    // Entries from earlier moves (or other games) only help with move
+    // ordering from here on, see maxNode().
+    TranspositionTable::shared().nextGeneration();
+
+    World root = state.world();
+    Direction best = moves.front();
+
+    for (uint32_t depth = 1; depth <= PARANOID_MAX_DEPTH; depth++)
+    {
+        // Search the best move from the last iteration first so the window
+        // is as narrow as possible for the rest.
+        std::stable_partition(moves.begin(), moves.end(),
+            [best](Direction dir) { return dir == best; });
+
+        int32_t alpha = -PARANOID_INFINITY;
+        Direction iterationBest = moves.front();
+        for (Direction dir : moves)
+        {
+            int32_t score = minNode(
+                root, state, dir, depth, alpha, PARANOID_INFINITY, 0);
+            if (_aborted)
+                break;
+
+            if (score > alpha)
+            {
+                alpha = score;
+                iterationBest = dir;
+            }
+        }
+
+        // An unfinished iteration might not have looked at the best move.
+        if (_aborted)
+            break;
+
+        best = iterationBest;
+        _stats.depth = depth;
+
+        // Win or loss is already forced so going deeper won't change it.
+        if (std::abs(alpha) >= PARANOID_DECIDED)
+            break;
+    }
+
+    return best;
+}
+
+bool Paranoid::outOfTime()
+{
+    if (!_aborted && _stats.nodes % PARANOID_TIME_CHECK_INTERVAL == 0)
+    {
+        _aborted = _deadline.expired();
+    }
+    return _aborted;
+}
+
+int32_t Paranoid::maxNode(
+    World &world, uint32_t depth, int32_t alpha, int32_t beta, uint32_t ply)
+{
+    _stats.nodes++;
+    if (outOfTime())
+    {
+        return 0;
+    }
+
+    GameState state(world);
+    if (state.isLoss())
+    {
+        return -PARANOID_WIN + ply;
+    }
+    if (state.enemies().empty())
+    {
+        return PARANOID_WIN - ply;
+    }
+    if (depth == 0)
+    {
+        return evaluate(state);
+    }
+
+    std::vector<Direction> moves = legalDirections(state, state.mySnake());
+    if (moves.empty())
+    {
+        // Every move is a loss next turn anyway.
+        return -PARANOID_WIN + ply + 1;
+    }
+
+    TranspositionTable &table = TranspositionTable::shared();
+    uint64_t key = state.hash() ^ PARANOID_TABLE_SALT;
+    uint64_t data = 0;
+    bool current = false;
+    if (table.probe(key, data, current))
+    {
+        _stats.tableHits++;
+        ParanoidEntry found = unpackEntry(data);
+        found.score = scoreFromTable(found.score, ply);
+
+        // An old entry might be from a position with different health (the
+        // hash only has it to within a bucket) so its score can't be trusted,
+        // but its move is still a good first guess.
+        if (current && found.depth >= depth)
+        {
+            if (found.bound == ParanoidBound::Exact)
+                return found.score;
+            if (found.bound == ParanoidBound::Lower)
+                alpha = std::max(alpha, found.score);
+            if (found.bound == ParanoidBound::Upper)
+                beta = std::min(beta, found.score);
+            if (alpha >= beta)
+                return found.score;
+        }
+
+        Direction tableMove = found.bestMove;
+        std::stable_partition(moves.begin(), moves.end(),
+            [tableMove](Direction dir) { return dir == tableMove; });
+    }
+
+    int32_t originalAlpha = alpha;
+    int32_t best = -PARANOID_INFINITY;
+    Direction bestMove = moves.front();
+    for (Direction dir : moves)
+    {
+        int32_t score = minNode(world, state, dir, depth, alpha, beta, ply);
+        if (_aborted)
+        {
+            return 0;
+        }
+
+        if (score > best)
+        {
+            best = score;
+            bestMove = dir;
+        }
+
+        alpha = std::max(alpha, score);
+        if (alpha >= beta)
+            break;
+    }
+
+    ParanoidBound bound = best <= originalAlpha
+        ? ParanoidBound::Upper
+        : best >= beta ? ParanoidBound::Lower : ParanoidBound::Exact;
+    table.store(
+        key,
+        packEntry({ depth, scoreToTable(best, ply), bound, bestMove }),
+        static_cast<uint8_t>(depth));
+
+    return best;
+}
+
+int32_t Paranoid::minNode(
+    World &world,
+    GameState &state,
+    Direction myMove,
+    uint32_t depth,
+    int32_t alpha,
+    int32_t beta,
+    uint32_t ply)
+{
+    Point myNextHead = coordAfterMove(state.mySnake()->head(), myMove);
+
+    // Each enemy's replies, the ones that get closest to me first since those
+    // are the ones most likely to cause a cutoff.
+    size_t myIndex = 0;
+    std::vector<std::pair<size_t, std::vector<Direction>>> enemyMoves;
+    for (size_t i = 0; i < world.snakes.size(); i++)
+    {
+        if (world.snakes[i].id == world.you)
+        {
+            myIndex = i;
+            continue;
+        }
+
+        auto found = state.snakes().find(world.snakes[i].id);
+        if (found == state.snakes().end())
+            continue;
+
+        Snake *enemy = found->second;
+        std::vector<Direction> moves = legalDirections(state, enemy);
+        if (moves.empty())
+        {
+            moves.push_back(Direction::Up);
+        }
+
+        Point head = enemy->head();
+        std::stable_sort(moves.begin(), moves.end(),
+            [head, myNextHead](Direction a, Direction b)
+            {
+                return distance(coordAfterMove(head, a), myNextHead)
+                    < distance(coordAfterMove(head, b), myNextHead);
+            });
+
+        enemyMoves.push_back({ i, std::move(moves) });
+    }
+
+    int32_t best = PARANOID_INFINITY;
+    std::vector<size_t> choice(enemyMoves.size(), 0);
+    while (true)
+    {
+        World next = world;
+        std::vector<SnakeMove> moves { { &next.snakes[myIndex], myMove } };
+        for (size_t e = 0; e < enemyMoves.size(); e++)
+        {
+            moves.push_back({
+                &next.snakes[enemyMoves[e].first],
+                enemyMoves[e].second[choice[e]]
+            });
+        }
+        applyMoves(next, moves);
+
+        int32_t score = maxNode(next, depth - 1, alpha, beta, ply + 1);
+        if (_aborted)
+        {
+            return 0;
+        }
+
+        best = std::min(best, score);
+        beta = std::min(beta, score);
+        if (alpha >= beta)
+            break;
+
+        // Next joint reply.
+        size_t e = 0;
+        while (e < choice.size() && ++choice[e] == enemyMoves[e].second.size())
+        {
+            choice[e] = 0;
+            e++;
+        }
+        if (e == choice.size())
+            break;
+    }
+
+    return best;
+}
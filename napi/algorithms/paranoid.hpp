@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../snakelib.hpp"
+#include "cautious.hpp"
+
+struct ParanoidStats
+{
+    uint32_t depth;
+    uint32_t nodes;
+    uint32_t tableHits;
+};
+
+enum class ParanoidBound : uint8_t
+{
+    Exact,
+    Lower,
+    Upper
+};
+
+struct ParanoidEntry
+{
+    uint32_t depth;
+    int32_t score;
+    ParanoidBound bound;
+    Direction bestMove;
+};
+
+// Iterative deepening alpha-beta where every enemy is assumed to be out to get
+// me (paranoid search). Each ply is my move followed by the worst joint enemy
+// reply for me. Fully deterministic so it's best suited to small endgames
+// where rollouts tend to miss the one line that matters.
+class Paranoid : public Algorithm
+{
+public:
+    Paranoid();
+    Paranoid(uint32_t maxMillis);
+    Metadata meta() override;
+    Direction move(GameState &state) override;
+    Direction move(GameState &state, const Deadline &deadline) override;
+    void start(std::string id) override;
+
+    ParanoidStats lastStats() { return _stats; }
+
+private:
+    int32_t maxNode(
+        World &world, uint32_t depth, int32_t alpha, int32_t beta, uint32_t ply);
+    int32_t minNode(
+        World &world,
+        GameState &state,
+        Direction myMove,
+        uint32_t depth,
+        int32_t alpha,
+        int32_t beta,
+        uint32_t ply);
+    bool outOfTime();
+
+    uint32_t _maxMillis;
+    Deadline _deadline;
+    bool _aborted;
+    ParanoidStats _stats;
+    Cautious _cautious;
+};
@@ -9,17 +9,63 @@
 #include "../movement.hpp"
 #include "../astar.hpp"
 #include "../simulator.hpp"
+#include "../log.hpp"
 
 #include <functional>
 #include <unordered_map>
 
-Sim::Sim() : _maxTurns(10000), _maxMillis(120)
+// Time kept back from the deadline for scoring the futures and replying.
+#define SCORING_RESERVE_MILLIS 20
+
+// How long past their deadline the simulations are allowed to run before they
+// get cancelled.
+#define SIM_GRACE_MILLIS 5
+
+// How long pondering is allowed to go on for if no move request shows up.
+#define PONDER_MAX_MILLIS 2000
+
+// Simulations of the state I expect the next move request to have, started as
+// soon as a move is sent. Everything the simulations point at lives in here
+// (or in the Sim) so that they can keep going after move() returns.
+struct Ponder
+{
+    Ponder(std::unique_ptr<GameState> predicted) :
+        state(std::move(predicted)),
+        inMyFace(state->mySnake())
+    { }
+
+    std::unique_ptr<GameState> state;
+    InYourFace inMyFace;
+    SimulationHandle simulations;
+};
+
+Sim::Sim() : Sim(10000, 120)
+{ }
+
+Sim::Sim(uint32_t maxTurns, uint32_t maxMillis, bool ponder) :
+    Sim(maxTurns, maxMillis, ponder, false)
 { }
 
-Sim::Sim(uint32_t maxTurns, uint32_t maxMillis) :
-    _maxTurns(maxTurns), _maxMillis(maxMillis)
+Sim::Sim(uint32_t maxTurns, uint32_t maxMillis, bool ponder, bool horizon) :
+    _maxTurns(maxTurns),
+    _maxMillis(maxMillis),
+    _ponder(ponder),
+    _horizon(horizon),
+    _lastMoveWasPondered(false),
+    _left(Direction::Left),
+    _right(Direction::Right),
+    _up(Direction::Up),
+    _down(Direction::Down)
 { }
 
+// Defined here where Ponder is a complete type. Pondering is stopped first
+// since its simulations are still using the algorithms below, which would
+// otherwise go before it.
+Sim::~Sim()
+{
+    _pondering.reset();
+}
+
 Metadata Sim::meta()
 {
     return {
@@ -35,12 +81,22 @@ Metadata Sim::meta()
 
 void Sim::start(std::string /*id*/)
 {
-    // Make sure the simulation threads are all awake so that it's not slow on
-    // the first move.
-    SimThread::wakeAll();
+    // Make sure the simulation threads exist so that it's not slow on the
+    // first move.
+    SimThread::startAll();
 }
 
 Direction Sim::move(GameState &state)
+{
+    // Nobody said when the answer is due so give the simulations their whole
+    // budget.
+    return move(state, Deadline::fromNow(_maxMillis + SCORING_RESERVE_MILLIS));
+}
+
+void Sim::algorithmSets(
+    InYourFace &inMyFace,
+    std::vector<PrefixedAlgorithm> &myAlgorithms,
+    std::vector<PrefixedAlgorithm> &enemyAlgorithms)
 {
     Direction l = Direction::Left;
     Direction r = Direction::Right;
@@ -62,42 +118,156 @@ Direction Sim::move(GameState &state)
         { r, d }
     };
 
+    if (_horizon)
+    {
+        // Every way of carrying on from each two move prefix without
+        // turning back.
+        std::vector<std::vector<Direction>> longer;
+        for (std::vector<Direction> &prefix : myPrefixMoves)
+        {
+            for (Direction next : { u, d, l, r })
+            {
+                if (next != oppositeDirection(prefix.back()))
+                {
+                    longer.push_back({ prefix[0], prefix[1], next });
+                }
+            }
+        }
+        myPrefixMoves = longer;
+    }
+
     std::vector<std::vector<Direction>> enemyPrefixMoves {
         {l},{r},{u},{d}
     };
-    InYourFace inYourFace;
-    InYourFace inMyFace(state.mySnake());
-    Hungry hungry;
-    Cautious cautious;
-    Terminator terminator;
-    Random random;
-    Dog dog;
-
-    OneDirection left(Direction::Left);
-    OneDirection right(Direction::Right);
-    OneDirection up(Direction::Up);
-    OneDirection down(Direction::Down);
-
-    std::vector<PrefixedAlgorithm> myAlgorithms {
-        { &dog, myPrefixMoves },
-        { &cautious, {} },
-        { &inYourFace, {} },
+
+    myAlgorithms = {
+        { &_dog, myPrefixMoves },
+        { &_cautious, {} },
+        { &_inYourFace, {} },
     };
-    std::vector<PrefixedAlgorithm> enemyAlgorithms {
-        { &hungry, { } },
+    enemyAlgorithms = {
+        { &_hungry, { } },
         { &inMyFace, enemyPrefixMoves },
-        { &left, { } },
-        { &right, { } },
-        { &up, { } },
-        { &down, { } },
+        { &_left, { } },
+        { &_right, { } },
+        { &_up, { } },
+        { &_down, { } },
     };
+}
 
-    Direction preferred = dog.move(state);
+Direction Sim::move(GameState &state, const Deadline &deadline)
+{
+    // Never simulate for longer than _maxMillis, and if the request has been
+    // sitting around for a while simulate for less so that there's still time
+    // to score the results.
+    Deadline simDeadline = deadline
+        .reserve(SCORING_RESERVE_MILLIS)
+        .earliest(Deadline::fromNow(_maxMillis));
+
+    // If this is the state that was pondered then those simulations already
+    // have a head start so just let them keep going. Otherwise they're no use.
+    std::unique_ptr<Ponder> ponder = std::move(_pondering);
+    _lastMoveWasPondered = ponder && ponder->state->hash() == state.hash();
+    if (!_lastMoveWasPondered)
+    {
+        ponder.reset();
+    }
+
+    InYourFace inMyFace(state.mySnake());
+    SimulationHandle simulations;
+    if (_lastMoveWasPondered)
+    {
+        LOG(LogLevel::Info) << "Continuing from pondered state";
+        simulations = std::move(ponder->simulations);
+    }
+    else
+    {
+        std::vector<PrefixedAlgorithm> myAlgorithms;
+        std::vector<PrefixedAlgorithm> enemyAlgorithms;
+        algorithmSets(inMyFace, myAlgorithms, enemyAlgorithms);
+        simulations = simulateFuturesAsync(
+            state, _maxTurns, simDeadline, myAlgorithms, enemyAlgorithms, _horizon);
+    }
+
+    // Work out the preferred move and everything about the first moves that
+    // doesn't depend on the futures while the simulation threads are busy.
+    Direction preferred = _dog.move(state);
+    FeatureTable features(state);
 
-    std::vector<Future> futures = simulateFutures(
-    	state, _maxTurns, _maxMillis, myAlgorithms, enemyAlgorithms);
+    // The simulations stop themselves at the deadline but if the threads are
+    // starved for CPU don't wait around forever for them. Pondered ones run
+    // to their own (later) deadline so they always need to be stopped.
+    Clock::time_point waitUntil = _lastMoveWasPondered
+        ? simDeadline.at()
+        : simDeadline.extend(SIM_GRACE_MILLIS).at();
+    if (!simulations.waitUntil(waitUntil))
+    {
+        simulations.cancel();
+    }
 
-    Direction best = bestMove(futures, state, MaybeDirection::just(preferred));
+    std::vector<Future> futures = simulations.get();
+    publishSimulatorMetrics(simulations.metrics());
+
+    Direction best = bestMove(
+        futures,
+        simulations.branches(),
+        state,
+        features,
+        MaybeDirection::just(preferred));
+
+    if (_ponder)
+    {
+        startPondering(state, best);
+    }
 
     return best;
 }
+
+void Sim::startPondering(GameState &state, Direction myMove)
+{
+    _pondering = std::make_unique<Ponder>(predictNextState(state, myMove));
+    if (_pondering->state->isLoss())
+    {
+        _pondering.reset();
+        return;
+    }
+
+    std::vector<PrefixedAlgorithm> myAlgorithms;
+    std::vector<PrefixedAlgorithm> enemyAlgorithms;
+    algorithmSets(_pondering->inMyFace, myAlgorithms, enemyAlgorithms);
+    _pondering->simulations = simulateFuturesAsync(
+        *_pondering->state,
+        _maxTurns,
+        Deadline::fromNow(PONDER_MAX_MILLIS),
+        myAlgorithms,
+        enemyAlgorithms,
+        _horizon);
+    _pondering->simulations.makePreemptible();
+}
+
+std::unique_ptr<GameState> predictNextState(GameState &state, Direction myMove)
+{
+    Cautious cautious;
+    std::vector<SnakeMove> moves { { state.mySnake(), myMove } };
+    for (Snake *enemy : state.enemies())
+    {
+        GameState &enemyState = state.perspective(enemy, AxisBias::Vertical);
+        moves.push_back({ enemy, cautious.move(enemyState) });
+    }
+
+    World next = state.world();
+    applyMoves(next, moves);
+
+    // The simulator doesn't bother with health but the server takes one off
+    // every turn (and fills it back up after eating) and health is part of
+    // the hash, so do the same here or the next request would never match.
+    for (Snake &snake : next.snakes)
+    {
+        Snake *before = state.snakes()[snake.id];
+        bool ate = snake.length() > before->length();
+        snake.health = ate ? 100 : (before->health > 0 ? before->health - 1 : 0);
+    }
+    next.hasHash = false;
+
+    return std::make_unique<GameState>(next);
+}
@@ -1,17 +1,63 @@
 #pragma once
 
 #include "../snakelib.hpp"
+#include "../simulator.hpp"
+#include "inyourface.hpp"
+#include "hungry.hpp"
+#include "cautious.hpp"
+#include "dog.hpp"
+#include "onedirection.hpp"
+
+// How far ahead "sim_horizon" looks before scoring where it got to instead.
+#define SIM_HORIZON_TURNS 20
+
+struct Ponder;
 
 class Sim : public Algorithm
 {
 public:
     Sim();
-    Sim(uint32_t maxTurns, uint32_t maxMillis);
+    Sim(uint32_t maxTurns, uint32_t maxMillis, bool ponder = false);
+
+    // With a horizon every simulation stops at maxTurns and is scored by how
+    // its last state looks (see leafScore), so they're cheap enough that I
+    // get three move prefixes instead of two and many more branches.
+    Sim(uint32_t maxTurns, uint32_t maxMillis, bool ponder, bool horizon);
+    ~Sim();
     Metadata meta() override;
     Direction move(GameState &state) override;
+    Direction move(GameState &state, const Deadline &deadline) override;
     void start(std::string id) override;
 
+    // Whether the last move picked up where pondering left off.
+    bool lastMoveWasPondered() { return _lastMoveWasPondered; }
+
 private:
+    void algorithmSets(
+        InYourFace &inMyFace,
+        std::vector<PrefixedAlgorithm> &myAlgorithms,
+        std::vector<PrefixedAlgorithm> &enemyAlgorithms);
+    void startPondering(GameState &state, Direction myMove);
+
     uint32_t _maxTurns;
     uint32_t _maxMillis;
+    bool _ponder;
+    bool _horizon;
+    bool _lastMoveWasPondered;
+    std::unique_ptr<Ponder> _pondering;
+
+    // These outlive any one move since pondering keeps using them after
+    // move() returns.
+    InYourFace _inYourFace;
+    Hungry _hungry;
+    Cautious _cautious;
+    Dog _dog;
+    OneDirection _left;
+    OneDirection _right;
+    OneDirection _up;
+    OneDirection _down;
 };
+
+// Best guess at the state the next move request will have if I go the given
+// way, with each enemy moving the way Cautious would.
+std::unique_ptr<GameState> predictNextState(GameState &state, Direction myMove);
@@ -1,5 +1,5 @@
 #include "terminator.hpp"
-#include "../movement.hpp"
+#include "../policy.hpp"
 #include "../astar.hpp"
 
 #include <functional>
@@ -24,18 +24,5 @@ void Terminator::start(std::string /*id*/)
 
 Direction Terminator::move(GameState &state)
 {
-    auto killTunnelDir = closestKillTunnelTarget(state, 2);
-    if (killTunnelDir.hasValue)
-    {
-        return killTunnelDir.value;
-    }
-
-    auto foodDir = closestFood(state);
-    if (foodDir.hasValue)
-    {
-        return foodDir.value;
-    }
-
-    auto alt = notImmediatelySuicidal(state);
-    return alt.value;
+    return policyMove<TerminatorPolicy>(state);
 }
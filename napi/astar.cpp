@@ -1,4 +1,5 @@
 #include "astar.hpp"
+#include "log.hpp"
 
 #include <algorithm>
 #include <unordered_set>
@@ -17,7 +18,9 @@ struct MemoryPool
         gScore(20),
         fScore(20),
         turns(20)
-    { }
+    {
+        neighbors.reserve(4);
+    }
 
     MemoryPool(const MemoryPool &) = delete;
     MemoryPool(MemoryPool &&) = delete;
@@ -28,6 +31,7 @@ struct MemoryPool
     std::unordered_map<uint32_t, uint32_t> gScore;
     std::unordered_map<uint32_t, uint32_t> fScore;
     std::unordered_map<uint32_t, uint32_t> turns;
+    std::vector<uint32_t> neighbors;
 
     static thread_local MemoryPool instance;
 };
@@ -42,6 +46,7 @@ void clean(MemoryPool &pool)
     pool.gScore.clear();
     pool.fScore.clear();
     pool.turns.clear();
+    pool.neighbors.clear();
 }
 
 inline uint32_t heuristicCostEstimate(Point start, Point goal)
@@ -131,10 +136,13 @@ inline bool isOkNeighbor(
     return result;
 }
 
-inline std::vector<uint32_t> getNeighbors(
-    uint32_t index, uint32_t turn, GameState &state)
+inline void getNeighbors(
+    uint32_t index,
+    uint32_t turn,
+    GameState &state,
+    std::vector<uint32_t> &result)
 {
-    std::vector<uint32_t> result;
+    result.clear();
 
     uint32_t right = index + 1;
     uint32_t left = index - 1;
@@ -155,8 +163,6 @@ inline std::vector<uint32_t> getNeighbors(
         if (isOkNeighbor(index, up, turn, state)) result.push_back(up);
         if (isOkNeighbor(index, down, turn, state)) result.push_back(down);
     }
-
-    return result;
 }
 
 inline uint32_t getGScore(
@@ -209,6 +215,7 @@ Path shortestPath(Point start, Point goal, GameState &state)
     std::unordered_map<uint32_t, uint32_t> &gScore = pool.gScore;
     std::unordered_map<uint32_t, uint32_t> &fScore = pool.fScore;
     std::unordered_map<uint32_t, uint32_t> &turns = pool.turns;
+    std::vector<uint32_t> &neighbors = pool.neighbors;
 
     openSet.insert(startIndex);
     gScore.emplace(startIndex, 0);
@@ -221,7 +228,8 @@ Path shortestPath(Point start, Point goal, GameState &state)
         // Make sure to never get stuck in loop.
         if (safety++ > MAX_ITERATIONS)
         {
-            std::cout << "Out of control loop in A*! Quitting after max iterations." << std::endl;
+            LOG(LogLevel::Warning)
+                << "Out of control loop in A*! Quitting after max iterations.";
             break;
         }
 
@@ -235,8 +243,7 @@ Path shortestPath(Point start, Point goal, GameState &state)
         openSet.erase(currentIndex);
         closedSet.insert(currentIndex);
 
-        std::vector<uint32_t> neighbors = getNeighbors(
-            currentIndex, turns[currentIndex], state);
+        getNeighbors(currentIndex, turns[currentIndex], state, neighbors);
         for (uint32_t neighborIndex : neighbors)
         {
             if (closedSet.find(neighborIndex) != closedSet.end())
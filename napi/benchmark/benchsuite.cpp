@@ -7,9 +7,22 @@
 #include "benchsuite.hpp"
 #include "../snakelib.hpp"
 #include "../algorithms/sim.hpp"
+#include "../algorithms/mcts.hpp"
+#include "../algorithms/paranoid.hpp"
+#include "../algorithms/cautious.hpp"
+#include "../algorithms/hungry.hpp"
 #include "../timing.hpp"
 #include "../astar.hpp"
 #include "../movement.hpp"
+#include "../simulator.hpp"
+#include "../transposition.hpp"
+#include "../matrixgame.hpp"
+#include "../voronoi.hpp"
+#include "../evaluator.hpp"
+#include <ctime>
+#include <sstream>
+#include <thread>
+#include <algorithm>
 
 void simulatorOnBusyGrid1()
 {
@@ -80,6 +93,63 @@ void simulatorOnBusyGrid2()
     {
         sim.move(state);
     });
+
+    latestSimulatorMetrics().prettyPrint();
+}
+
+// Same deep rollouts with the real algorithms the whole way, with the cheap
+// tier taking over after the usual number of turns and with only the cheap
+// tier.
+void deepRollouts()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ > > 0 _ _ _ _ 1 < _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ * _ _ _ _ _ * _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ > 2 _ _ _ _ _ 3 < _",
+        "_ _ _ _ _ _ _ _ _ _ _"
+    }));
+
+    Cautious cautious;
+    Hungry hungry;
+    std::vector<std::pair<std::string, uint32_t>> configs {
+        { "expensive", NO_CHEAP_TIER },
+        { "two tier", ROLLOUT_EXPENSIVE_TURNS },
+        { "cheap", 0 }
+    };
+
+    for (auto &config : configs)
+    {
+        uint32_t expensiveTurns = config.second;
+        std::vector<AlgorithmBranch> branches;
+        for (AxisBias bias : { AxisBias::Vertical, AxisBias::Horizontal })
+        {
+            branches.push_back({ { &cautious, &hungry }, { }, bias, expensiveTurns });
+            branches.push_back({ { &hungry, &cautious }, { }, bias, expensiveTurns });
+        }
+
+        auto start = Clock::now();
+        auto futures = runSimulationBranches(
+            branches, state, 200, Deadline::fromNow(10000));
+        Seconds time = Clock::now() - start;
+
+        uint32_t turns = 0;
+        for (Future &future : futures)
+        {
+            turns += future.turns;
+        }
+
+        std::cout << "rollouts - " << config.first
+            << " micros per simulated turn... "
+            << time.count() * 1000000.0 / std::max(turns, 1U)
+            << " (" << turns << " turns)" << std::endl;
+    }
 }
 
 void astar1()
@@ -113,6 +183,379 @@ void astar1()
     });
 }
 
+void simThreadWakeLatency()
+{
+    GameState state(parseWorld({
+        "_ _ _ _",
+        "_ 0 < _",
+        "_ _ _ _",
+        "_ 1 < _"
+    }));
+
+    // Hand every thread an empty batch and wait for all of them to report
+    // back so that the time measured is just the wakeup and completion
+    // handoff (plus copying a tiny state for each thread).
+    uint32_t rounds = 1000;
+    Seconds total(0);
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        auto start = Clock::now();
+        runSimulationsAsync({}, state, 0, Deadline()).get();
+        total += Clock::now() - start;
+    }
+
+    std::cout << "sim threads - wake to done round trip (micros)... "
+        << total.count() * 1000000.0 / rounds << std::endl;
+
+    // Idle threads should be blocked, not spinning, so the process should use
+    // next to no CPU time while nothing is happening.
+    std::clock_t cpuStart = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::clock_t cpuEnd = std::clock();
+    double cpuMillis = 1000.0 * (cpuEnd - cpuStart) / CLOCKS_PER_SEC;
+
+    std::cout << "sim threads - CPU millis used while idle for 200 millis... "
+        << cpuMillis << std::endl;
+}
+
+// Restarts the simulation threads with and without pinning and looks at the
+// spread of reply times for moves that are all due in the same time.
+void simThreadPinning()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ > > 0 _ _ _ _ 1 < _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ * _ _ _ _ _ * _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ > 2 _ _ _ _ _ 3 < _",
+        "_ _ _ _ _ _ _ _ _ _ _"
+    }));
+
+    SimThreadOptions original = SimThread::options;
+    uint32_t moves = 50;
+
+    for (bool pin : { false, true })
+    {
+        SimThread::stopAll();
+        SimThread::options = { original.threads, pin };
+        SimThread::startAll();
+
+        Sim sim(10000, 100);
+        std::vector<double> replyMillis;
+        for (uint32_t i = 0; i < moves; i++)
+        {
+            auto start = Clock::now();
+            sim.move(state, Deadline::after(start, 50));
+            Seconds time = Clock::now() - start;
+            replyMillis.push_back(time.count() * 1000.0);
+        }
+
+        std::sort(replyMillis.begin(), replyMillis.end());
+        std::cout << "sim threads - " << (pin ? "pinned" : "unpinned")
+            << " millis to reply when due in 50... p50 "
+            << replyMillis[moves / 2]
+            << " p99 " << replyMillis[moves * 99 / 100]
+            << " max " << replyMillis.back() << std::endl;
+    }
+
+    SimThread::stopAll();
+    SimThread::options = original;
+    SimThread::startAll();
+}
+
+void mctsVersusSim()
+{
+    std::vector<std::pair<std::string, std::vector<std::string>>> boards {
+        { "open 11x11", {
+            "_ _ _ _ _ _ _ _ _ _ _",
+            "_ > > 0 _ _ _ _ 1 < _",
+            "_ _ _ _ _ _ _ _ _ _ _",
+            "_ _ _ _ _ * _ _ _ _ _",
+            "_ _ _ _ _ _ _ _ _ _ _",
+            "_ _ * _ _ _ _ _ * _ _",
+            "_ _ _ _ _ _ _ _ _ _ _",
+            "_ _ _ _ _ * _ _ _ _ _",
+            "_ _ _ _ _ _ _ _ _ _ _",
+            "_ > 2 _ _ _ _ _ 3 < _",
+            "_ _ _ _ _ _ _ _ _ _ _"
+        } },
+        { "crowded 11x11", {
+            "_ _ _ _ _ _ _ _ _ _ _",
+            "_ > > > v _ _ _ _ _ _",
+            "_ _ _ _ v _ _ _ * _ _",
+            "_ _ _ _ 0 _ 1 < < < _",
+            "_ _ _ _ _ _ _ _ _ _ _",
+            "_ _ * _ _ _ _ _ _ _ _",
+            "_ _ _ _ 2 < < < < _ _",
+            "_ _ _ _ _ _ _ _ ^ _ _",
+            "_ _ _ * _ _ _ _ ^ < _",
+            "_ _ _ _ _ _ _ _ _ _ _",
+            "_ _ _ _ _ _ _ _ _ _ _"
+        } },
+        { "duel 7x7", {
+            "_ _ _ _ _ _ _",
+            "_ > > 0 _ _ _",
+            "_ _ _ _ _ * _",
+            "_ _ _ * _ _ _",
+            "_ * _ _ _ _ _",
+            "_ _ _ 1 < < _",
+            "_ _ _ _ _ _ _"
+        } }
+    };
+
+    // Same budget for both so the comparison is on what each does with it.
+    uint32_t budgetMillis = 120;
+    Sim sim(10000, budgetMillis);
+    Mcts mcts(budgetMillis, 40);
+    sim.start("bench");
+    mcts.start("bench");
+
+    for (auto &board : boards)
+    {
+        GameState state(parseWorld(board.second));
+
+        auto simStart = Clock::now();
+        Direction simMove = sim.move(state);
+        Seconds simTime = Clock::now() - simStart;
+
+        auto mctsStart = Clock::now();
+        Direction mctsMove = mcts.move(state);
+        Seconds mctsTime = Clock::now() - mctsStart;
+        MctsStats stats = mcts.lastStats();
+
+        std::cout << "sim vs mcts - " << board.first
+            << " - sim picked " << directionToString(simMove)
+            << " in " << simTime.count() * 1000.0 << " millis" << std::endl;
+        std::cout << "sim vs mcts - " << board.first
+            << " - mcts picked " << directionToString(mctsMove)
+            << " in " << mctsTime.count() * 1000.0 << " millis ("
+            << stats.iterations << " iterations, "
+            << stats.nodes << " nodes, depth "
+            << stats.maxDepth << ")" << std::endl;
+    }
+}
+
+// About the size of the game bestMove solves for Sim: 14 options for me
+// against 12 enemy responses.
+void matrixGameSolve()
+{
+    MatrixGame game;
+    game.rows = 14;
+    game.cols = 12;
+    srand(1);
+    for (size_t r = 0; r < game.rows; r++)
+    {
+        for (size_t c = 0; c < game.cols; c++)
+        {
+            game.payoff[r][c] = rand() / static_cast<double>(RAND_MAX);
+        }
+    }
+
+    benchmark("matrix game - 14x12 with 1000 iterations", [&game]()
+    {
+        game.solve(1000);
+    });
+}
+
+// A leaf evaluation has to be cheap enough to run at the end of every
+// truncated rollout.
+void voronoiTerritory19x19()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _",
+        "_ > > > > 0 _ _ _ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ * _ _ _ _ _ _ _ _ _ _ _ _ 1 _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ ^ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ ^ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ ^ < _",
+        "_ _ _ _ _ _ _ _ _ * _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ * _ _ _",
+        "_ _ 2 _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _",
+        "_ _ ^ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _",
+        "_ _ ^ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _",
+        "_ _ ^ < _ _ _ _ _ * _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ 3 < < < _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _"
+    }));
+
+    // One call on its own is mostly building the layout and cold caches, so
+    // time a lot of them.
+    uint32_t calls = 10000;
+    int32_t total = 0;
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        total += territoryAdvantage(state);
+    }
+    Seconds time = Clock::now() - start;
+
+    std::cout << "voronoi - 19x19 with 4 snakes micros per call... "
+        << time.count() * 1000000.0 / calls << std::endl;
+    std::cout << "voronoi - advantage " << total / static_cast<int32_t>(calls) << std::endl;
+}
+
+// Random weights, since it's the cost of inference that matters here rather
+// than the answer.
+void evaluatorInference()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ > > > 0 _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ 2 _ _",
+        "_ _ _ _ _ _ _ _ ^ _ _",
+        "_ _ _ _ _ _ _ _ ^ _ _",
+        "_ _ _ _ _ _ _ * _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ 1 < < < _",
+        "_ _ _ _ _ _ _ _ _ _ _"
+    }));
+
+    srand(1);
+    std::stringstream weights;
+    weights << "evaluator " << EVALUATOR_RADIUS << " " << EVALUATOR_PLANES << " "
+        << EVALUATOR_SCALARS << " " << EVALUATOR_HIDDEN;
+    size_t count = EVALUATOR_HIDDEN * (EVALUATOR_INPUTS + 2) + 1;
+    for (size_t i = 0; i < count; i++)
+    {
+        weights << " " << (rand() / static_cast<double>(RAND_MAX) - 0.5);
+    }
+
+    Evaluator evaluator;
+    evaluator.load(weights);
+
+    // Building the inputs and running the network take about a microsecond,
+    // so time a lot of calls rather than one cold one.
+    uint32_t calls = 100000;
+    float total = 0.0f;
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++)
+    {
+        total += evaluator.evaluate(state, state.mySnake());
+    }
+    Seconds time = Clock::now() - start;
+
+    std::cout << "evaluator - 11x11 with 3 snakes micros per call... "
+        << time.count() * 1000000.0 / calls << std::endl;
+    std::cout << "evaluator - " << total / static_cast<float>(calls) << std::endl;
+}
+
+// Same position and budget with and without a rollout horizon. The horizon
+// version should get through a lot more branches, each of them shorter.
+void simHorizon()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ > > > 0 _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ 2 _ _",
+        "_ _ _ _ _ _ _ _ ^ _ _",
+        "_ _ _ _ _ _ _ _ ^ _ _",
+        "_ _ _ _ _ _ _ * _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ 1 < < < _",
+        "_ _ _ _ _ _ _ _ _ _ _"
+    }));
+
+    uint32_t budgetMillis = 120;
+    Sim full(10000, budgetMillis);
+    Sim horizon(SIM_HORIZON_TURNS, budgetMillis, false, true);
+
+    for (Sim *sim : { &full, &horizon })
+    {
+        auto start = Clock::now();
+        Direction move = sim->move(state);
+        Seconds time = Clock::now() - start;
+        SimulatorMetrics metrics = latestSimulatorMetrics();
+        std::cout << (sim == &full ? "sim - full rollouts" : "sim - horizon rollouts")
+            << " picked " << directionToString(move)
+            << " in " << time.count() * 1000.0 << " millis ("
+            << metrics.branches << " branches, "
+            << metrics.turns << " turns)" << std::endl;
+    }
+}
+
+// Both of these come down to table lookups on 5x5 neighbourhoods.
+void tacticalChecks()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ > > 0 _ _ _ _ 1 < _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ * _ _ _ _ _ * _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ > 2 _ _ _ _ _ 3 < _",
+        "_ _ _ _ _ _ _ _ _ _ _"
+    }));
+
+    uint32_t dangers = 0;
+    benchmark("tactical - corner danger for all four moves", [&state, &dangers]()
+    {
+        for (Direction move : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+        {
+            dangers += couldEndUpCornerAdjacentToBiggerSnake(state, move);
+        }
+    });
+
+    benchmark("tactical - kill tunnels with range 2", [&state]()
+    {
+        closestKillTunnelTarget(state, 2);
+    });
+}
+
+void paranoidDepth()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ > > > 0 _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ * _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ * _ _ _",
+        "_ _ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ 1 < < < _",
+        "_ _ _ _ _ _ _ _ _ _ _"
+    }));
+
+    uint32_t budgetMillis = 120;
+    Paranoid paranoid(budgetMillis);
+
+    auto start = Clock::now();
+    Direction move = paranoid.move(state);
+    Seconds time = Clock::now() - start;
+    ParanoidStats stats = paranoid.lastStats();
+    double millis = time.count() * 1000.0;
+
+    std::cout << "paranoid - 1v1 picked " << directionToString(move)
+        << " at depth " << stats.depth << " in " << millis << " millis ("
+        << stats.depth / millis << " depth per milli, "
+        << stats.nodes << " nodes, "
+        << stats.tableHits << " table hits)" << std::endl;
+
+    TranspositionStats table = TranspositionTable::shared().stats();
+    std::cout << "paranoid - shared table " << table.probes << " probes, "
+        << table.hits << " hits, " << table.collisions << " collisions, "
+        << table.stores << " stores" << std::endl;
+}
+
 void BenchSuite::run()
 {
     for (auto i = 0; i < 1; i++)
@@ -121,5 +564,15 @@ void BenchSuite::run()
         simulatorOnBusyGrid1();
         simulatorOnBusyGrid2();
         astar1();
+        deepRollouts();
+        simThreadWakeLatency();
+        simThreadPinning();
+        mctsVersusSim();
+        paranoidDepth();
+        matrixGameSolve();
+        voronoiTerritory19x19();
+        evaluatorInference();
+        simHorizon();
+        tacticalChecks();
     }
 }
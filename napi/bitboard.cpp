@@ -0,0 +1,122 @@
+#include "bitboard.hpp"
+
+BitboardLayout::BitboardLayout(uint32_t width, uint32_t height) :
+    _width(width),
+    _height(height),
+    _words((static_cast<size_t>(width) * height + 63) / 64),
+    _fits(static_cast<size_t>(width) * height <= BITBOARD_CELLS)
+{
+    if (!_fits)
+    {
+        _words = 0;
+        return;
+    }
+
+    for (uint32_t index = 0; index < width * height; index++)
+    {
+        _valid.set(index);
+        if (index % width != 0)
+        {
+            _notFirstColumn.set(index);
+        }
+        if (index % width != width - 1)
+        {
+            _notLastColumn.set(index);
+        }
+    }
+}
+
+void BitboardLayout::orShiftedForwards(
+    const Bitboard &from, uint32_t cells, Bitboard &result) const
+{
+    size_t wordShift = cells / 64;
+    uint32_t bitShift = cells % 64;
+    for (size_t i = _words; i-- > wordShift;)
+    {
+        size_t source = i - wordShift;
+        uint64_t value = from.words[source] << bitShift;
+        if (bitShift != 0 && source > 0)
+        {
+            value |= from.words[source - 1] >> (64 - bitShift);
+        }
+        result.words[i] |= value;
+    }
+}
+
+void BitboardLayout::orShiftedBackwards(
+    const Bitboard &from, uint32_t cells, Bitboard &result) const
+{
+    size_t wordShift = cells / 64;
+    uint32_t bitShift = cells % 64;
+    for (size_t i = 0; i + wordShift < _words; i++)
+    {
+        size_t source = i + wordShift;
+        uint64_t value = from.words[source] >> bitShift;
+        if (bitShift != 0 && source + 1 < _words)
+        {
+            value |= from.words[source + 1] << (64 - bitShift);
+        }
+        result.words[i] |= value;
+    }
+}
+
+void BitboardLayout::neighbors(const Bitboard &from, Bitboard &result) const
+{
+    if (_words > 0)
+    {
+        neighbors(from, result, 0, _words - 1);
+    }
+}
+
+void BitboardLayout::neighbors(
+    const Bitboard &from, Bitboard &result, size_t first, size_t last) const
+{
+    // Rows up to a word wide only ever move bits into the next or previous
+    // word so each word of the result can be worked out in one go from its
+    // own word and the two either side.
+    if (_width < 64)
+    {
+        for (size_t i = first; i <= last; i++)
+        {
+            uint64_t word = from.words[i];
+            uint64_t before = i > 0 ? from.words[i - 1] : 0;
+            uint64_t after = i + 1 < _words ? from.words[i + 1] : 0;
+
+            // Moving right or left by one cell would wrap onto the next or
+            // previous row at the edges so those get masked off.
+            uint64_t right = (word << 1) | (before >> 63);
+            uint64_t left = (word >> 1) | (after << 63);
+            uint64_t down = (word << _width) | (before >> (64 - _width));
+            uint64_t up = (word >> _width) | (after << (64 - _width));
+            result.words[i] = ((right & _notFirstColumn.words[i])
+                | (left & _notLastColumn.words[i])
+                | down
+                | up) & _valid.words[i];
+        }
+        return;
+    }
+
+    Bitboard right;
+    Bitboard left;
+    Bitboard vertical;
+    orShiftedForwards(from, 1, right);
+    orShiftedBackwards(from, 1, left);
+    orShiftedForwards(from, _width, vertical);
+    orShiftedBackwards(from, _width, vertical);
+    for (size_t i = first; i <= last; i++)
+    {
+        result.words[i] = ((right.words[i] & _notFirstColumn.words[i])
+            | (left.words[i] & _notLastColumn.words[i])
+            | vertical.words[i]) & _valid.words[i];
+    }
+}
+
+size_t BitboardLayout::count(const Bitboard &board) const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < _words; i++)
+    {
+        total += __builtin_popcountll(board.words[i]);
+    }
+    return total;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+// Enough for a 32x32 board.
+#define BITBOARD_WORDS 16
+#define BITBOARD_CELLS (BITBOARD_WORDS * 64)
+
+// One bit per cell, in the same order as cellIndex(). Only the words that
+// the board actually needs get touched, so a 19x19 board costs 6 words per
+// operation rather than all of them.
+struct Bitboard
+{
+    std::array<uint64_t, BITBOARD_WORDS> words {};
+
+    void set(uint32_t index)
+    {
+        words[index / 64] |= 1ULL << (index % 64);
+    }
+
+    void clear(uint32_t index)
+    {
+        words[index / 64] &= ~(1ULL << (index % 64));
+    }
+
+    bool test(uint32_t index) const
+    {
+        return (words[index / 64] >> (index % 64)) & 1;
+    }
+};
+
+// The size of a board and the masks needed to move bits around on it
+// without wrapping from one row to the next.
+class BitboardLayout
+{
+public:
+    BitboardLayout(uint32_t width, uint32_t height);
+
+    // False if the board has more cells than a Bitboard can hold.
+    bool fits() const { return _fits; }
+    size_t words() const { return _words; }
+    uint32_t width() const { return _width; }
+    uint32_t height() const { return _height; }
+
+    // Every cell one step from a cell in from, staying on the board.
+    void neighbors(const Bitboard &from, Bitboard &result) const;
+
+    // Same but only works out words first to last of the result (the rest
+    // are left as they were), eg: the words around the only bits that are
+    // set in from.
+    void neighbors(
+        const Bitboard &from, Bitboard &result, size_t first, size_t last) const;
+
+    size_t count(const Bitboard &board) const;
+
+private:
+    // Moves every bit this many cells forwards/backwards in cellIndex()
+    // order and ors it into result.
+    void orShiftedForwards(const Bitboard &from, uint32_t cells, Bitboard &result) const;
+    void orShiftedBackwards(const Bitboard &from, uint32_t cells, Bitboard &result) const;
+
+    uint32_t _width;
+    uint32_t _height;
+    size_t _words;
+    bool _fits;
+    Bitboard _valid;
+    Bitboard _notFirstColumn;
+    Bitboard _notLastColumn;
+};
@@ -0,0 +1,325 @@
+#include "evaluator.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Adds inputs to the list, leaving out anything outside the window. Nothing
+// gets checked for being set already: the only thing that can land on the
+// same cell twice is a stack of body parts (eg: at the start of a game) and
+// those are next to each other, so the caller skips them.
+class InputWriter
+{
+public:
+    InputWriter(EvaluatorInputs &inputs, Point head) :
+        _inputs(inputs),
+        _head(head)
+    {
+        _inputs.count = 0;
+    }
+
+    void add(EvaluatorPlane plane, Point p)
+    {
+        // Unsigned so a point left of/above the window wraps and fails the
+        // same check as one to the right/below.
+        uint32_t column = p.x - _head.x + EVALUATOR_RADIUS;
+        uint32_t row = p.y - _head.y + EVALUATOR_RADIUS;
+        if (column >= EVALUATOR_WINDOW || row >= EVALUATOR_WINDOW)
+            return;
+
+        _inputs.active[_inputs.count++] = static_cast<uint16_t>(
+            planeStart(plane) + row * EVALUATOR_WINDOW + column);
+    }
+
+    // Every part of a snake but the head, once each.
+    void addBody(EvaluatorPlane plane, const std::vector<Point> &parts)
+    {
+        for (size_t i = 1; i < parts.size(); i++)
+        {
+            if (i == 1 || !(parts[i] == parts[i - 1]))
+            {
+                add(plane, parts[i]);
+            }
+        }
+    }
+
+    // The cells in the window that are off the board, row by row. Only the
+    // board's edges are looked at: a row is either all off the board or
+    // off it for a run of columns on the left and/or right.
+    void addWalls(uint32_t width, uint32_t height)
+    {
+        int32_t left = static_cast<int32_t>(_head.x) - EVALUATOR_RADIUS;
+        int32_t top = static_cast<int32_t>(_head.y) - EVALUATOR_RADIUS;
+
+        // Columns of the window that are on the board are [onFrom, onTo).
+        int32_t onFrom = std::min(std::max(-left, 0), EVALUATOR_WINDOW);
+        int32_t onTo = std::max(
+            std::min(static_cast<int32_t>(width) - left, EVALUATOR_WINDOW), onFrom);
+
+        uint32_t base = planeStart(EvaluatorPlane::Wall);
+        for (int32_t row = 0; row < EVALUATOR_WINDOW; row++)
+        {
+            uint32_t rowStart = base + static_cast<uint32_t>(row) * EVALUATOR_WINDOW;
+            int32_t y = top + row;
+            if (y < 0 || y >= static_cast<int32_t>(height))
+            {
+                addRun(rowStart, 0, EVALUATOR_WINDOW);
+            }
+            else
+            {
+                addRun(rowStart, 0, onFrom);
+                addRun(rowStart, onTo, EVALUATOR_WINDOW);
+            }
+        }
+    }
+
+private:
+    void addRun(uint32_t rowStart, int32_t from, int32_t to)
+    {
+        for (int32_t column = from; column < to; column++)
+        {
+            _inputs.active[_inputs.count++] =
+                static_cast<uint16_t>(rowStart + static_cast<uint32_t>(column));
+        }
+    }
+
+    static uint32_t planeStart(EvaluatorPlane plane)
+    {
+        return static_cast<uint32_t>(plane) * EVALUATOR_WINDOW * EVALUATOR_WINDOW;
+    }
+
+    EvaluatorInputs &_inputs;
+    Point _head;
+};
+
+void evaluatorInputs(GameState &state, Snake *snake, EvaluatorInputs &inputs)
+{
+    InputWriter writer(inputs, snake->head());
+    uint32_t longestEnemy = 0;
+
+    for (Snake &other : state.world().snakes)
+    {
+        if (other.parts.empty())
+            continue;
+
+        if (&other == snake)
+        {
+            writer.addBody(EvaluatorPlane::MyBody, other.parts);
+            continue;
+        }
+
+        longestEnemy = std::max(longestEnemy, other.length());
+        writer.add(
+            other.length() >= snake->length()
+                ? EvaluatorPlane::BiggerHead
+                : EvaluatorPlane::SmallerHead,
+            other.head());
+        writer.addBody(EvaluatorPlane::EnemyBody, other.parts);
+    }
+
+    for (Point food : state.food())
+    {
+        writer.add(EvaluatorPlane::Food, food);
+    }
+
+    writer.addWalls(state.width(), state.height());
+
+    inputs.scalars[0] = snake->health / 100.0f;
+    inputs.scalars[1] =
+        (static_cast<float>(snake->length()) - static_cast<float>(longestEnemy)) / 10.0f;
+}
+
+Evaluator::Evaluator() :
+    _loaded(false),
+    _hiddenBiases {},
+    _hiddenWeights(EVALUATOR_INPUTS * EVALUATOR_HIDDEN, 0.0f),
+    _outputWeights {},
+    _outputBias(0.0f)
+{
+}
+
+bool Evaluator::load(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        LOG(LogLevel::Warning) << "Can't open evaluator weights " << path;
+        return false;
+    }
+
+    bool result = load(in);
+    if (!result)
+    {
+        LOG(LogLevel::Warning) << "Evaluator weights in " << path << " don't fit";
+    }
+    return result;
+}
+
+bool Evaluator::load(std::istream &in)
+{
+    std::string magic;
+    uint32_t radius, planes, scalars, hidden;
+    in >> magic >> radius >> planes >> scalars >> hidden;
+    if (!in
+        || magic != "evaluator"
+        || radius != EVALUATOR_RADIUS
+        || planes != EVALUATOR_PLANES
+        || scalars != EVALUATOR_SCALARS
+        || hidden != EVALUATOR_HIDDEN)
+    {
+        return false;
+    }
+
+    // Read into copies so that a short file leaves the old weights alone.
+    std::array<float, EVALUATOR_HIDDEN> hiddenBiases;
+    std::vector<float> hiddenWeights(EVALUATOR_INPUTS * EVALUATOR_HIDDEN);
+    std::array<float, EVALUATOR_HIDDEN> outputWeights;
+    float outputBias;
+
+    for (float &weight : hiddenBiases) in >> weight;
+    for (float &weight : hiddenWeights) in >> weight;
+    for (float &weight : outputWeights) in >> weight;
+    in >> outputBias;
+    if (!in)
+        return false;
+
+    _hiddenBiases = hiddenBiases;
+    _hiddenWeights = std::move(hiddenWeights);
+    _outputWeights = outputWeights;
+    _outputBias = outputBias;
+    _loaded = true;
+    return true;
+}
+
+float Evaluator::evaluate(GameState &state, Snake *snake) const
+{
+    EvaluatorInputs inputs;
+    evaluatorInputs(state, snake, inputs);
+    return evaluate(inputs);
+}
+
+// The hidden layer is the bias plus the weight row of every active plane
+// input (they're all exactly 1) plus the scaled rows of the scalars, so it's
+// a handful of row additions rather than a full matrix multiply.
+float Evaluator::evaluate(const EvaluatorInputs &inputs) const
+{
+    const float *weights = _hiddenWeights.data();
+    const float *scalarRows = weights + EVALUATOR_PLANE_INPUTS * EVALUATOR_HIDDEN;
+    float output;
+
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256 hidden[EVALUATOR_HIDDEN / 8];
+    for (size_t h = 0; h < EVALUATOR_HIDDEN / 8; h++)
+    {
+        hidden[h] = _mm256_loadu_ps(&_hiddenBiases[h * 8]);
+    }
+
+    for (size_t i = 0; i < inputs.count; i++)
+    {
+        const float *row = weights + inputs.active[i] * EVALUATOR_HIDDEN;
+        for (size_t h = 0; h < EVALUATOR_HIDDEN / 8; h++)
+        {
+            hidden[h] = _mm256_add_ps(hidden[h], _mm256_loadu_ps(row + h * 8));
+        }
+    }
+
+    for (size_t s = 0; s < EVALUATOR_SCALARS; s++)
+    {
+        const float *row = scalarRows + s * EVALUATOR_HIDDEN;
+        __m256 scale = _mm256_set1_ps(inputs.scalars[s]);
+        for (size_t h = 0; h < EVALUATOR_HIDDEN / 8; h++)
+        {
+            hidden[h] = _mm256_fmadd_ps(scale, _mm256_loadu_ps(row + h * 8), hidden[h]);
+        }
+    }
+
+    __m256 zero = _mm256_setzero_ps();
+    __m256 sum = zero;
+    for (size_t h = 0; h < EVALUATOR_HIDDEN / 8; h++)
+    {
+        __m256 active = _mm256_max_ps(hidden[h], zero);
+        sum = _mm256_fmadd_ps(active, _mm256_loadu_ps(&_outputWeights[h * 8]), sum);
+    }
+
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    output = _mm_cvtss_f32(half) + _outputBias;
+#elif defined(__SSE2__)
+    __m128 hidden[EVALUATOR_HIDDEN / 4];
+    for (size_t h = 0; h < EVALUATOR_HIDDEN / 4; h++)
+    {
+        hidden[h] = _mm_loadu_ps(&_hiddenBiases[h * 4]);
+    }
+
+    for (size_t i = 0; i < inputs.count; i++)
+    {
+        const float *row = weights + inputs.active[i] * EVALUATOR_HIDDEN;
+        for (size_t h = 0; h < EVALUATOR_HIDDEN / 4; h++)
+        {
+            hidden[h] = _mm_add_ps(hidden[h], _mm_loadu_ps(row + h * 4));
+        }
+    }
+
+    for (size_t s = 0; s < EVALUATOR_SCALARS; s++)
+    {
+        const float *row = scalarRows + s * EVALUATOR_HIDDEN;
+        __m128 scale = _mm_set1_ps(inputs.scalars[s]);
+        for (size_t h = 0; h < EVALUATOR_HIDDEN / 4; h++)
+        {
+            hidden[h] = _mm_add_ps(hidden[h], _mm_mul_ps(scale, _mm_loadu_ps(row + h * 4)));
+        }
+    }
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 sum = zero;
+    for (size_t h = 0; h < EVALUATOR_HIDDEN / 4; h++)
+    {
+        __m128 active = _mm_max_ps(hidden[h], zero);
+        sum = _mm_add_ps(sum, _mm_mul_ps(active, _mm_loadu_ps(&_outputWeights[h * 4])));
+    }
+
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    output = _mm_cvtss_f32(sum) + _outputBias;
+#else
+    std::array<float, EVALUATOR_HIDDEN> hidden = _hiddenBiases;
+    for (size_t i = 0; i < inputs.count; i++)
+    {
+        const float *row = weights + inputs.active[i] * EVALUATOR_HIDDEN;
+        for (size_t h = 0; h < EVALUATOR_HIDDEN; h++)
+        {
+            hidden[h] += row[h];
+        }
+    }
+
+    for (size_t s = 0; s < EVALUATOR_SCALARS; s++)
+    {
+        const float *row = scalarRows + s * EVALUATOR_HIDDEN;
+        for (size_t h = 0; h < EVALUATOR_HIDDEN; h++)
+        {
+            hidden[h] += inputs.scalars[s] * row[h];
+        }
+    }
+
+    output = _outputBias;
+    for (size_t h = 0; h < EVALUATOR_HIDDEN; h++)
+    {
+        output += std::max(hidden[h], 0.0f) * _outputWeights[h];
+    }
+#endif
+
+    return 1.0f / (1.0f + std::exp(-output));
+}
+
+Evaluator &Evaluator::shared()
+{
+    static Evaluator evaluator;
+    return evaluator;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "snakelib.hpp"
+#include <array>
+#include <istream>
+#include <string>
+#include <vector>
+
+// How many cells either side of the head the evaluator looks at.
+#define EVALUATOR_RADIUS 5
+#define EVALUATOR_WINDOW (2 * EVALUATOR_RADIUS + 1)
+
+// One plane per thing a cell can hold, see EvaluatorPlane.
+#define EVALUATOR_PLANES 6
+#define EVALUATOR_PLANE_INPUTS (EVALUATOR_PLANES * EVALUATOR_WINDOW * EVALUATOR_WINDOW)
+
+// Inputs that aren't on the board: health and how my length compares to the
+// longest enemy's.
+#define EVALUATOR_SCALARS 2
+#define EVALUATOR_INPUTS (EVALUATOR_PLANE_INPUTS + EVALUATOR_SCALARS)
+
+// Units in the hidden layer. Has to be a multiple of 8 so that each row of
+// weights is a whole number of AVX registers.
+#define EVALUATOR_HIDDEN 16
+
+// What scoreFuture() adds for a future whose last state the evaluator is
+// sure I'll win from.
+#define EVALUATOR_SCORE_WEIGHT 1000
+
+enum class EvaluatorPlane
+{
+    MyBody, EnemyBody, BiggerHead, SmallerHead, Food, Wall
+};
+
+// A window of the board centred on one snake's head. Almost every plane
+// input is zero so only the ones that are set get listed.
+struct EvaluatorInputs
+{
+    std::array<uint16_t, EVALUATOR_PLANE_INPUTS> active;
+    size_t count;
+    std::array<float, EVALUATOR_SCALARS> scalars;
+};
+
+void evaluatorInputs(GameState &state, Snake *snake, EvaluatorInputs &inputs);
+
+// A small MLP that guesses how likely a snake is to win from a position,
+// with weights fitted offline on positions from the exporter (see
+// nonode/export.cpp). Until weights are loaded it isn't used at all.
+//
+// The weights file is whitespace separated text:
+//   evaluator <radius> <planes> <scalars> <hidden>
+//   <hidden biases> <hidden weights, one row per input> <output weights> <output bias>
+//
+// Loading isn't thread safe so it has to happen at startup before the
+// simulation threads are running.
+class Evaluator
+{
+public:
+    Evaluator();
+
+    bool load(const std::string &path);
+    bool load(std::istream &in);
+    bool loaded() const { return _loaded; }
+
+    // Between 0 and 1.
+    float evaluate(GameState &state, Snake *snake) const;
+    float evaluate(const EvaluatorInputs &inputs) const;
+
+    static Evaluator &shared();
+
+private:
+    bool _loaded;
+    std::array<float, EVALUATOR_HIDDEN> _hiddenBiases;
+    std::vector<float> _hiddenWeights;
+    std::array<float, EVALUATOR_HIDDEN> _outputWeights;
+    float _outputBias;
+};
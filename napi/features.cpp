@@ -0,0 +1,20 @@
+#include "features.hpp"
+#include "rollout.hpp"
+
+FeatureTable::FeatureTable(GameState &state)
+{
+    Snake *me = state.mySnake();
+    FoodDistanceField foodField;
+    foodField.update(state);
+
+    for (Direction move : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+    {
+        Point next = coordAfterMove(me->head(), move);
+        _moves[static_cast<size_t>(move)] = {
+            countAccessibleCellsAfterMove(state, me, move),
+            couldEndUpCornerAdjacentToBiggerSnake(state, move),
+            nextToBiggerHead(state, me, next),
+            foodField.at(next, state)
+        };
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "snakelib.hpp"
+#include <array>
+
+// Everything about one of my first moves that only depends on the state the
+// move is made from, so it's the same for every future that starts with it.
+struct MoveFeatures
+{
+    // Cells I could get to after the move (see countAccessibleCells).
+    uint32_t accessible;
+
+    // See couldEndUpCornerAdjacentToBiggerSnake.
+    bool cornerDanger;
+
+    // An enemy at least as long as me could move into the same cell.
+    bool headToHeadRisk;
+
+    // Steps to the closest food from the new head, ignoring snakes, or
+    // NO_FOOD_DISTANCE.
+    uint32_t foodDistance;
+};
+
+// MoveFeatures for all four first moves. Scoring used to work these out per
+// future (and cache the spaces on the World) but they're cheap enough to just
+// do once up front, which the caller can do while the simulations run.
+class FeatureTable
+{
+public:
+    FeatureTable(GameState &state);
+
+    const MoveFeatures &at(Direction move) const
+    {
+        return _moves[static_cast<size_t>(move)];
+    }
+
+private:
+    std::array<MoveFeatures, 4> _moves;
+};
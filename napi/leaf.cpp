@@ -0,0 +1,47 @@
+#include "leaf.hpp"
+#include "voronoi.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+// Ignoring snakes, like FoodDistanceField. Zero if there's no food at all so
+// that it doesn't count for or against anything.
+uint32_t closestFoodDistance(GameState &state, Point from)
+{
+    uint32_t closest = 0;
+    bool found = false;
+    for (Point food : state.food())
+    {
+        uint32_t distance =
+            std::abs(static_cast<int32_t>(food.x) - static_cast<int32_t>(from.x))
+            + std::abs(static_cast<int32_t>(food.y) - static_cast<int32_t>(from.y));
+        if (!found || distance < closest)
+        {
+            closest = distance;
+            found = true;
+        }
+    }
+    return closest;
+}
+
+int32_t leafScore(GameState &state, uint32_t health)
+{
+    Snake *me = state.mySnake();
+    if (me == nullptr)
+        return -LEAF_SCORE_LIMIT;
+
+    uint32_t longestEnemy = 0;
+    for (Snake *enemy : state.enemies())
+    {
+        longestEnemy = std::max(longestEnemy, enemy->length());
+    }
+
+    int32_t lengthAdvantage =
+        static_cast<int32_t>(me->length()) - static_cast<int32_t>(longestEnemy);
+    int32_t foodDistance = closestFoodDistance(state, me->head());
+
+    int32_t score = territoryAdvantage(state) * LEAF_TERRITORY_WEIGHT
+        + lengthAdvantage * LEAF_LENGTH_WEIGHT
+        + static_cast<int32_t>(health) * LEAF_HEALTH_WEIGHT
+        - foodDistance * LEAF_FOOD_DISTANCE_WEIGHT;
+    return std::max(-LEAF_SCORE_LIMIT, std::min(score, LEAF_SCORE_LIMIT));
+}
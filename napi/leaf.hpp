@@ -0,0 +1,19 @@
+#pragma once
+
+#include "snakelib.hpp"
+
+// Points for each part of leafScore().
+#define LEAF_TERRITORY_WEIGHT 50
+#define LEAF_LENGTH_WEIGHT 300
+#define LEAF_HEALTH_WEIGHT 20
+#define LEAF_FOOD_DISTANCE_WEIGHT 50
+
+// Leaf scores never go past this either way, so being cut off in a good
+// spot can't outweigh the survival and murder parts of scoreFuture().
+#define LEAF_SCORE_LIMIT 20000
+
+// How good the state a simulation got cut off in looks for me: more territory
+// than the best enemy (see voronoi.hpp), being longer than the longest enemy,
+// health and being close to food. The simulator doesn't keep track of health
+// so the caller passes in its best guess. Positive is good for me.
+int32_t leafScore(GameState &state, uint32_t health);
@@ -0,0 +1,195 @@
+#include "log.hpp"
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+// Number of messages the shared logger can hold before it starts dropping.
+#define SHARED_LOG_SLOTS 4096
+
+// Longest the flusher sleeps without being woken up, in case a wakeup was
+// missed (eg: the ring went past the high water mark between two checks).
+#define LOG_IDLE_TIMEOUT_MILLIS 500
+
+static size_t ringSize(size_t slots)
+{
+    size_t result = 1;
+    while (result < slots)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+Logger::Logger(size_t slots, std::ostream &out) :
+    _slots(ringSize(slots)),
+    _mask(_slots.size() - 1),
+    _out(out),
+    _level(LogLevel::Info),
+    _head(0),
+    _next(0),
+    _written(0),
+    _dropped(0),
+    _quit(false)
+{
+    // A slot is free to log into at position p when its sequence is p and
+    // ready to be written out when its sequence is p + 1.
+    for (size_t i = 0; i < _slots.size(); i++)
+    {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    _thread = std::thread(&Logger::flusher, this);
+}
+
+Logger::~Logger()
+{
+    _quit = true;
+    wakeFlusher();
+    _thread.join();
+}
+
+void Logger::setLevel(LogLevel level)
+{
+    _level.store(level, std::memory_order_relaxed);
+}
+
+bool Logger::write(LogLevel level, const std::string &message)
+{
+    if (!enabled(level))
+        return true;
+
+    uint64_t position = _head.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true)
+    {
+        slot = &_slots[position & _mask];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence - position);
+        if (diff == 0)
+        {
+            if (_head.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // Still holding a message from one lap ago.
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            position = _head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->length = static_cast<uint32_t>(
+        std::min(message.size(), static_cast<size_t>(LOG_MESSAGE_BYTES)));
+    std::memcpy(slot->text, message.data(), slot->length);
+
+    // The first message since the flusher caught up has to wake it. After
+    // that it's awake until the ring is empty again, unless it's falling
+    // behind, in which case a nudge at half full doesn't hurt. Sequentially
+    // consistent (like the flusher's side) so that either the flusher sees
+    // this message or this sees that the flusher has caught up.
+    slot->sequence.store(position + 1, std::memory_order_seq_cst);
+    uint64_t waiting = position + 1 - _written.load(std::memory_order_seq_cst);
+    if (waiting == 1 || waiting == _slots.size() / 2)
+    {
+        wakeFlusher();
+    }
+    return true;
+}
+
+// Taking the lock means the flusher is either still awake (and will see the
+// message when it checks) or already waiting (and gets the notification).
+void Logger::wakeFlusher()
+{
+    std::lock_guard<std::mutex> lock(_wakeMutex);
+    _wake.notify_one();
+}
+
+bool Logger::readyToWrite()
+{
+    Slot &slot = _slots[_next & _mask];
+    return slot.sequence.load(std::memory_order_seq_cst) == _next + 1;
+}
+
+bool Logger::writeOne()
+{
+    if (!readyToWrite())
+        return false;
+
+    Slot &slot = _slots[_next & _mask];
+    _out.write(slot.text, slot.length);
+    _out.put('\n');
+
+    slot.sequence.store(_next + _slots.size(), std::memory_order_release);
+    _next++;
+    _written.store(_next, std::memory_order_seq_cst);
+    return true;
+}
+
+void Logger::flusher()
+{
+    while (true)
+    {
+        bool wroteAny = false;
+        while (writeOne())
+        {
+            wroteAny = true;
+        }
+
+        if (wroteAny)
+        {
+            _out.flush();
+        }
+        else if (_quit)
+        {
+            break;
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(_wakeMutex);
+            _wake.wait_for(
+                lock,
+                std::chrono::milliseconds(LOG_IDLE_TIMEOUT_MILLIS),
+                [this]() { return _quit || readyToWrite(); });
+        }
+    }
+}
+
+void Logger::flush()
+{
+    uint64_t target = _head.load(std::memory_order_relaxed);
+    while (_written.load(std::memory_order_acquire) < target)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+uint64_t Logger::dropped()
+{
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+Logger &Logger::shared()
+{
+    static Logger logger(SHARED_LOG_SLOTS, std::cout);
+    return logger;
+}
+
+LogLevel logLevelFromString(const std::string &name)
+{
+    if (name == "debug")
+        return LogLevel::Debug;
+    if (name == "warning")
+        return LogLevel::Warning;
+    if (name == "error")
+        return LogLevel::Error;
+    if (name == "none")
+        return LogLevel::None;
+    return LogLevel::Info;
+}
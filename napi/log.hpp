@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <ostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Longer messages get cut off.
+#define LOG_MESSAGE_BYTES 240
+
+enum class LogLevel : uint8_t
+{
+    Debug, Info, Warning, Error, None
+};
+
+// Logging that's cheap enough for the request path and the simulation threads.
+// Messages are copied into a fixed size ring buffer and a background thread
+// writes them out, so nobody ever waits on stdout. Any number of threads can
+// log at once without locks (each slot has a sequence number saying whose
+// turn it is). If the flusher falls that far behind then new messages are
+// dropped and counted instead of blocking. The flusher sleeps until a message
+// turns up after a quiet spell or the ring is filling up, so an idle logger
+// costs nothing.
+class Logger
+{
+public:
+    // Size is rounded up to a power of two.
+    Logger(size_t slots, std::ostream &out);
+    ~Logger();
+
+    bool enabled(LogLevel level) const
+    {
+        return level >= _level.load(std::memory_order_relaxed);
+    }
+
+    void setLevel(LogLevel level);
+
+    // Returns false if the message had to be dropped.
+    bool write(LogLevel level, const std::string &message);
+
+    // Waits until everything logged so far has been written out.
+    void flush();
+
+    uint64_t dropped();
+
+    static Logger &shared();
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        LogLevel level;
+        uint32_t length;
+        char text[LOG_MESSAGE_BYTES];
+    };
+
+    void flusher();
+    bool readyToWrite();
+    bool writeOne();
+    void wakeFlusher();
+
+    std::vector<Slot> _slots;
+    uint64_t _mask;
+    std::ostream &_out;
+    std::atomic<LogLevel> _level;
+
+    // Next position to log into and (only touched by the flusher) next one
+    // to write out.
+    std::atomic<uint64_t> _head;
+    uint64_t _next;
+    std::atomic<uint64_t> _written;
+    std::atomic<uint64_t> _dropped;
+    std::atomic<bool> _quit;
+    std::mutex _wakeMutex;
+    std::condition_variable _wake;
+    std::thread _thread;
+};
+
+LogLevel logLevelFromString(const std::string &name);
+
+// Builds up one message and logs it when it goes out of scope.
+class LogLine
+{
+public:
+    LogLine(LogLevel level) : _level(level)
+    { }
+
+    ~LogLine()
+    {
+        Logger::shared().write(_level, _message.str());
+    }
+
+    template <typename T>
+    LogLine &operator<<(const T &value)
+    {
+        _message << value;
+        return *this;
+    }
+
+private:
+    LogLevel _level;
+    std::ostringstream _message;
+};
+
+// Usage: LOG(LogLevel::Info) << "something " << 123;
+// Nothing after the << gets evaluated unless the level is enabled.
+#define LOG(level) \
+    if (!Logger::shared().enabled(level)) ; else LogLine(level)
@@ -0,0 +1,111 @@
+#include "matrixgame.hpp"
+#include <algorithm>
+
+// Turns accumulated regrets (which are never negative) into a strategy. With
+// no regret for anything yet everything is equally likely.
+template <size_t N>
+void strategyFromRegrets(
+    const std::array<double, N> &regrets, size_t count, std::array<double, N> &strategy)
+{
+    double total = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        total += regrets[i];
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        strategy[i] = total > 0.0 ? regrets[i] / total : 1.0 / count;
+    }
+}
+
+void MatrixGame::solve(uint32_t iterations)
+{
+    rowStrategy.fill(0.0);
+    colStrategy.fill(0.0);
+    value = 0.0;
+    if (rows == 0 || cols == 0)
+        return;
+
+    std::array<double, MATRIX_GAME_MAX_ROWS> rowRegrets {};
+    std::array<double, MATRIX_GAME_MAX_COLS> colRegrets {};
+    std::array<double, MATRIX_GAME_MAX_ROWS> rowCurrent;
+    std::array<double, MATRIX_GAME_MAX_COLS> colCurrent;
+    std::array<double, MATRIX_GAME_MAX_ROWS> rowPayoffs;
+    std::array<double, MATRIX_GAME_MAX_COLS> colPayoffs;
+    double totalWeight = 0.0;
+
+    for (uint32_t t = 1; t <= iterations; t++)
+    {
+        strategyFromRegrets(rowRegrets, rows, rowCurrent);
+        strategyFromRegrets(colRegrets, cols, colCurrent);
+
+        // What each row would get against the current column strategy and
+        // vice versa.
+        double expected = 0.0;
+        for (size_t r = 0; r < rows; r++)
+        {
+            rowPayoffs[r] = 0.0;
+            for (size_t c = 0; c < cols; c++)
+            {
+                rowPayoffs[r] += payoff[r][c] * colCurrent[c];
+            }
+            expected += rowPayoffs[r] * rowCurrent[r];
+        }
+
+        for (size_t c = 0; c < cols; c++)
+        {
+            colPayoffs[c] = 0.0;
+            for (size_t r = 0; r < rows; r++)
+            {
+                colPayoffs[c] += payoff[r][c] * rowCurrent[r];
+            }
+        }
+
+        // The column player wants the payoff to be small.
+        for (size_t r = 0; r < rows; r++)
+        {
+            rowRegrets[r] = std::max(0.0, rowRegrets[r] + rowPayoffs[r] - expected);
+        }
+        for (size_t c = 0; c < cols; c++)
+        {
+            colRegrets[c] = std::max(0.0, colRegrets[c] + expected - colPayoffs[c]);
+        }
+
+        // Later iterations count for more, which is what makes the averages
+        // converge quickly with regret matching+.
+        for (size_t r = 0; r < rows; r++)
+        {
+            rowStrategy[r] += t * rowCurrent[r];
+        }
+        for (size_t c = 0; c < cols; c++)
+        {
+            colStrategy[c] += t * colCurrent[c];
+        }
+        totalWeight += t;
+    }
+
+    for (size_t r = 0; r < rows; r++)
+    {
+        rowStrategy[r] /= totalWeight;
+    }
+    for (size_t c = 0; c < cols; c++)
+    {
+        colStrategy[c] /= totalWeight;
+    }
+
+    for (size_t r = 0; r < rows; r++)
+    {
+        value += rowStrategy[r] * rowValue(r);
+    }
+}
+
+double MatrixGame::rowValue(size_t row) const
+{
+    double result = 0.0;
+    for (size_t c = 0; c < cols; c++)
+    {
+        result += payoff[row][c] * colStrategy[c];
+    }
+    return result;
+}
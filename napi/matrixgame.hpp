@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+#define MATRIX_GAME_MAX_ROWS 64
+#define MATRIX_GAME_MAX_COLS 32
+
+// A zero sum game where one player picks a row, the other picks a column at
+// the same time, and the row player gets payoff[row][col]. Fixed size so that
+// setting one up and solving it doesn't allocate.
+struct MatrixGame
+{
+    size_t rows = 0;
+    size_t cols = 0;
+    std::array<std::array<double, MATRIX_GAME_MAX_COLS>, MATRIX_GAME_MAX_ROWS> payoff;
+
+    // Filled in by solve(): how often each side should play each of its
+    // options in equilibrium, and what the row player expects to get.
+    std::array<double, MATRIX_GAME_MAX_ROWS> rowStrategy;
+    std::array<double, MATRIX_GAME_MAX_COLS> colStrategy;
+    double value = 0.0;
+
+    // Regret matching+ for both players. The average strategies get within
+    // about range / sqrt(iterations) of an equilibrium.
+    void solve(uint32_t iterations);
+
+    // What a row gets against the column player's equilibrium strategy.
+    double rowValue(size_t row) const;
+};
@@ -1,6 +1,8 @@
 #include "movement.hpp"
 #include "astar.hpp"
 #include "snakelib.hpp"
+#include "log.hpp"
+#include "patterns.hpp"
 
 
 bool is180(Point p, GameState &state)
@@ -68,6 +70,27 @@ bool checkForOkCellsInRange(int range, Direction dir, Point cell, GameState &sta
     }
 }
 
+// Which ways on from a cell have range ok cells in a row. Ranges that fit in
+// a Neighborhood are a table lookup, longer ones go cell by cell.
+TunnelStep tunnelStepFrom(Point cell, int range, GameState &state)
+{
+    if (range >= 1 && range <= PATTERN_MAX_TUNNEL_RANGE)
+    {
+        return tunnelStep(neighborhood(state, cell), range);
+    }
+
+    TunnelStep step { 0, Direction::Up };
+    for (Direction dir : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+    {
+        if (checkForOkCellsInRange(range, dir, cell, state))
+        {
+            step.ways++;
+            step.last = dir;
+        }
+    }
+    return step;
+}
+
 MaybeDirection closestKillTunnelTarget(GameState &state, int killTunnelRange = 1)
 {
     Snake *me = state.mySnake();
@@ -80,91 +103,30 @@ MaybeDirection closestKillTunnelTarget(GameState &state, int killTunnelRange = 1
         Point head = enemy->head();
         Point currentCell = { head.x, head.y };
         std::vector<Point> cellPath;
-        Point nextCell;
-
-        int count = 0;
-        Direction lastDirection = Direction::Up;
-        //up
-
-        if(checkForOkCellsInRange(killTunnelRange, Direction::Up, currentCell, state))
-        {
-            nextCell = coordAfterMove(currentCell, Direction::Up, 1);
-            lastDirection = Direction::Up;
-            count++;
-        }
-
-        //down
-        if(checkForOkCellsInRange(killTunnelRange, Direction::Down, currentCell, state))
-        {
-            nextCell = coordAfterMove(currentCell, Direction::Down, 1);
-            lastDirection = Direction::Down;
-            count++;
-        }
-
-        //left
-        if(checkForOkCellsInRange(killTunnelRange, Direction::Left, currentCell, state))
-        {
-            nextCell = coordAfterMove(currentCell, Direction::Left, 1);
-            lastDirection = Direction::Left;
-            count++;
-        }
-
-        //right
-        if(checkForOkCellsInRange(killTunnelRange, Direction::Right, currentCell, state))
-        {
-            nextCell = coordAfterMove(currentCell, Direction::Right, 1);
-            lastDirection = Direction::Right;
-            count++;
-        }
 
         //a kill tunnel can only exist if only one neighbour cell is open
-        if(count != 1) {
+        TunnelStep step = tunnelStepFrom(currentCell, killTunnelRange, state);
+        if (step.ways != 1) {
             continue;
         }
 
+        Direction lastDirection = step.last;
+        Point nextCell = coordAfterMove(currentCell, step.last, 1);
         int bailOut = 0;
         int maxLoop = state.width() * state.height();
 
         //counter here so this CAN'T go infinite
 
-        while (count == 1 && bailOut < maxLoop)
+        while (step.ways == 1 && bailOut < maxLoop)
         {
-
-            count = 0;
-
             cellPath.push_back(nextCell);
             currentCell = nextCell;
-            //up
-
-            if(checkForOkCellsInRange(killTunnelRange, Direction::Up, currentCell, state))
-            {
-                nextCell = coordAfterMove(currentCell, Direction::Up, 1);
-                lastDirection = Direction::Up;
-                count++;
-            }
-
-            //down
-            if(checkForOkCellsInRange(killTunnelRange, Direction::Down, currentCell, state))
-            {
-                nextCell = coordAfterMove(currentCell, Direction::Down, 1);
-                lastDirection = Direction::Down;
-                count++;
-            }
-
-            //left
-            if(checkForOkCellsInRange(killTunnelRange, Direction::Left, currentCell, state))
-            {
-                nextCell = coordAfterMove(currentCell, Direction::Left, 1);
-                lastDirection = Direction::Left;
-                count++;
-            }
 
-            //right
-            if(checkForOkCellsInRange(killTunnelRange, Direction::Right, currentCell, state))
+            step = tunnelStepFrom(currentCell, killTunnelRange, state);
+            if (step.ways > 0)
             {
-                nextCell = coordAfterMove(currentCell, Direction::Right, 1);
-                lastDirection = Direction::Right;
-                count++;
+                nextCell = coordAfterMove(currentCell, step.last, 1);
+                lastDirection = step.last;
             }
 
             bailOut++;
@@ -175,9 +137,8 @@ MaybeDirection closestKillTunnelTarget(GameState &state, int killTunnelRange = 1
         if(cellPath.size() > validRange)
         {
             Point targetCell = coordAfterMove(cellPath.back(), lastDirection, 1);
-            std::cout << "TARGET CELL FOUND--> ";
-            targetCell.prettyPrint();
-            std::cout << std::endl;
+            LOG(LogLevel::Debug) << "TARGET CELL FOUND--> "
+                << targetCell.x << "," << targetCell.y;
             Path myPath = shortestPath(me->head(), targetCell, state);
             if (!myPath.direction.hasValue)
             {
@@ -0,0 +1,177 @@
+#include "patterns.hpp"
+#include <array>
+
+// Cells that cornerDanger() looks at and how many patterns they make.
+#define CORNER_CELLS 6
+#define CORNER_PATTERNS (1 << CORNER_CELLS)
+
+// Cells that tunnelStep() looks at (range cells out in each direction) and
+// how many patterns they make.
+#define TUNNEL_CELLS (4 * PATTERN_MAX_TUNNEL_RANGE)
+#define TUNNEL_PATTERNS (1 << TUNNEL_CELLS)
+
+uint32_t neighborhoodBit(int32_t dx, int32_t dy)
+{
+    return 1U << ((dy + NEIGHBORHOOD_RADIUS) * NEIGHBORHOOD_SIZE + dx + NEIGHBORHOOD_RADIUS);
+}
+
+// An offset that's written for moving up, turned to point the given way.
+Point rotateFromUp(int32_t dx, int32_t dy, Direction direction)
+{
+    switch (direction)
+    {
+        case Direction::Up: return { static_cast<uint32_t>(dx), static_cast<uint32_t>(dy) };
+        case Direction::Down: return { static_cast<uint32_t>(-dx), static_cast<uint32_t>(-dy) };
+        case Direction::Left: return { static_cast<uint32_t>(dy), static_cast<uint32_t>(-dx) };
+        default: return { static_cast<uint32_t>(-dy), static_cast<uint32_t>(dx) };
+    }
+}
+
+/*
+Numbers represent all the positions that are in the danger zone.
+ie: they could move into a corner-adjacent position to the '+'
+snake which is super dangerous. s, t, u, v, w, x, y, z are the
+destination points that we do not want the enemy snake to move to.
+_ _ _ _ _ _ _ _ _
+_ _ _ 3 _ 4 _ _ _
+_ _ 2 t _ u 5 _ _
+_ 1 s _ _ _ v 6 _
+_ _ _ _ + _ _ _ _
+_ c z _ _ _ w 7 _
+_ _ b y _ x 8 _ _
+_ _ _ a _ 9 _ _ _
+_ _ _ _ _ _ _ _ _
+
+Moving up they're t and u, with 2, 3, 4 and 5 being the heads that could
+get there. Relative to the cell I move into that's t (-1, -1), u (1, -1),
+2 (-2, -1), 3 (-1, -2), 4 (1, -2) and 5 (2, -1), which all fit in its
+neighbourhood. The other moves are the same thing turned around.
+*/
+struct PatternTables
+{
+    PatternTables()
+    {
+        // Bit order within a corner pattern: t open, u open, then a bigger
+        // head at 2, 3, 4 and 5.
+        std::array<std::array<int32_t, 2>, CORNER_CELLS> upCells { {
+            { -1, -1 }, { 1, -1 }, { -2, -1 }, { -1, -2 }, { 1, -2 }, { 2, -1 }
+        } };
+
+        for (Direction direction : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+        {
+            size_t d = static_cast<size_t>(direction);
+            for (size_t c = 0; c < CORNER_CELLS; c++)
+            {
+                Point p = rotateFromUp(upCells[c][0], upCells[c][1], direction);
+                cornerCells[d][c] = neighborhoodBit(
+                    static_cast<int32_t>(p.x), static_cast<int32_t>(p.y));
+            }
+
+            for (size_t distance = 1; distance <= PATTERN_MAX_TUNNEL_RANGE; distance++)
+            {
+                Point p = rotateFromUp(0, -static_cast<int32_t>(distance), direction);
+                tunnelCells[d * PATTERN_MAX_TUNNEL_RANGE + distance - 1] = neighborhoodBit(
+                    static_cast<int32_t>(p.x), static_cast<int32_t>(p.y));
+            }
+        }
+
+        for (uint32_t pattern = 0; pattern < CORNER_PATTERNS; pattern++)
+        {
+            bool tOpen = pattern & 1;
+            bool uOpen = pattern & 2;
+            bool headNearT = pattern & (4 | 8);
+            bool headNearU = pattern & (16 | 32);
+            corner[pattern] = (tOpen && headNearT) || (uOpen && headNearU);
+        }
+
+        for (uint32_t range = 1; range <= PATTERN_MAX_TUNNEL_RANGE; range++)
+        {
+            uint32_t runMask = (1U << range) - 1;
+            for (uint32_t pattern = 0; pattern < TUNNEL_PATTERNS; pattern++)
+            {
+                TunnelStep step { 0, Direction::Up };
+                for (Direction direction : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+                {
+                    uint32_t run = pattern
+                        >> (static_cast<uint32_t>(direction) * PATTERN_MAX_TUNNEL_RANGE);
+                    if ((run & runMask) == runMask)
+                    {
+                        step.ways++;
+                        step.last = direction;
+                    }
+                }
+                tunnel[range - 1][pattern] = step;
+            }
+        }
+    }
+
+    std::array<std::array<uint32_t, CORNER_CELLS>, 4> cornerCells;
+    std::array<uint32_t, TUNNEL_CELLS> tunnelCells;
+    std::array<bool, CORNER_PATTERNS> corner;
+    std::array<std::array<TunnelStep, TUNNEL_PATTERNS>, PATTERN_MAX_TUNNEL_RANGE> tunnel;
+};
+
+static const PatternTables tables;
+
+Neighborhood neighborhood(GameState &state, Point centre)
+{
+    Neighborhood result { 0, 0 };
+    Snake *me = state.mySnake();
+    bool hasNeck = me->length() > 1;
+    Point neck = hasNeck ? me->parts[1] : me->head();
+
+    for (int32_t dy = -NEIGHBORHOOD_RADIUS; dy <= NEIGHBORHOOD_RADIUS; dy++)
+    {
+        for (int32_t dx = -NEIGHBORHOOD_RADIUS; dx <= NEIGHBORHOOD_RADIUS; dx++)
+        {
+            Point p { centre.x + dx, centre.y + dy };
+            if (!outOfBounds(p, state)
+                && state.map().turnsUntilVacant(p) == 0
+                && !(hasNeck && p == neck))
+            {
+                result.open |= neighborhoodBit(dx, dy);
+            }
+        }
+    }
+
+    for (Snake *enemy : state.enemies())
+    {
+        if (enemy->length() < me->length())
+            continue;
+
+        // Unsigned so that heads off to the left or above wrap around and
+        // fail the same check as the ones off to the right or below.
+        Point head = enemy->head();
+        uint32_t column = head.x - centre.x + NEIGHBORHOOD_RADIUS;
+        uint32_t row = head.y - centre.y + NEIGHBORHOOD_RADIUS;
+        if (column < NEIGHBORHOOD_SIZE && row < NEIGHBORHOOD_SIZE)
+        {
+            result.biggerHeads |= 1U << (row * NEIGHBORHOOD_SIZE + column);
+        }
+    }
+
+    return result;
+}
+
+bool cornerDanger(const Neighborhood &around, Direction move)
+{
+    const std::array<uint32_t, CORNER_CELLS> &cells =
+        tables.cornerCells[static_cast<size_t>(move)];
+    uint32_t pattern = ((around.open & cells[0]) != 0)
+        | ((around.open & cells[1]) != 0) << 1
+        | ((around.biggerHeads & cells[2]) != 0) << 2
+        | ((around.biggerHeads & cells[3]) != 0) << 3
+        | ((around.biggerHeads & cells[4]) != 0) << 4
+        | ((around.biggerHeads & cells[5]) != 0) << 5;
+    return tables.corner[pattern];
+}
+
+TunnelStep tunnelStep(const Neighborhood &around, uint32_t range)
+{
+    uint32_t pattern = 0;
+    for (size_t c = 0; c < TUNNEL_CELLS; c++)
+    {
+        pattern |= ((around.open & tables.tunnelCells[c]) != 0) << c;
+    }
+    return tables.tunnel[range - 1][pattern];
+}
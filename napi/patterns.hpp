@@ -0,0 +1,43 @@
+#pragma once
+
+#include "snakelib.hpp"
+
+// A neighbourhood is the 5x5 cells around a point, one bit per cell going
+// row by row from the top left.
+#define NEIGHBORHOOD_RADIUS 2
+#define NEIGHBORHOOD_SIZE (2 * NEIGHBORHOOD_RADIUS + 1)
+
+// Longest kill tunnel range that fits in a neighbourhood. Anything longer has
+// to be checked cell by cell.
+#define PATTERN_MAX_TUNNEL_RANGE NEIGHBORHOOD_RADIUS
+
+// Everything the tactical checks need to know about the cells around a
+// point, worked out with one bounds check per cell. After that each check is
+// a lookup in a table built at startup, indexed by the handful of bits it
+// cares about.
+struct Neighborhood
+{
+    // On the board, free right now and not my neck (see isCellOk).
+    uint32_t open;
+
+    // The head of an enemy at least as long as me.
+    uint32_t biggerHeads;
+};
+
+Neighborhood neighborhood(GameState &state, Point centre);
+
+// couldEndUpCornerAdjacentToBiggerSnake() for a move, given the neighbourhood
+// of the cell the move takes my head to.
+bool cornerDanger(const Neighborhood &around, Direction move);
+
+// The ways out of the centre of a neighbourhood that have range ok cells in
+// a row, and the last of them in Up, Down, Left, Right order, which is the
+// one closestKillTunnelTarget() follows. Range has to be between 1 and
+// PATTERN_MAX_TUNNEL_RANGE.
+struct TunnelStep
+{
+    uint32_t ways;
+    Direction last;
+};
+
+TunnelStep tunnelStep(const Neighborhood &around, uint32_t range);
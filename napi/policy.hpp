@@ -0,0 +1,103 @@
+#pragma once
+
+#include "snakelib.hpp"
+#include "movement.hpp"
+
+// Building blocks for the fixed fallback chains that most of the simple
+// algorithms are made of. Each step is a type with a static step() so that a
+// whole chain is one concrete type the compiler can inline into a rollout
+// loop instead of going through a virtual Algorithm::move() every turn. eg:
+//
+//   typedef FirstOf<BestFood, ChaseTail, NotSuicidal> CautiousPolicy;
+//   Direction dir = policyMove<CautiousPolicy>(state);
+
+struct BestFood
+{
+    static MaybeDirection step(GameState &state) { return bestFood(state); }
+};
+
+struct ClosestFood
+{
+    static MaybeDirection step(GameState &state) { return closestFood(state); }
+};
+
+struct ChaseTail
+{
+    static MaybeDirection step(GameState &state) { return chaseTail(state); }
+};
+
+template <int Range>
+struct KillTunnel
+{
+    static MaybeDirection step(GameState &state)
+    {
+        return closestKillTunnelTarget(state, Range);
+    }
+};
+
+// Always has a value (even if every move is suicidal) so it goes last.
+struct NotSuicidal
+{
+    static MaybeDirection step(GameState &state)
+    {
+        return notImmediatelySuicidal(state);
+    }
+};
+
+// The first step in the list that comes up with a move.
+template <typename... Steps>
+struct FirstOf;
+
+template <typename Step>
+struct FirstOf<Step>
+{
+    static MaybeDirection step(GameState &state) { return Step::step(state); }
+};
+
+template <typename Step, typename... Rest>
+struct FirstOf<Step, Rest...>
+{
+    static MaybeDirection step(GameState &state)
+    {
+        MaybeDirection dir = Step::step(state);
+        return dir.hasValue ? dir : FirstOf<Rest...>::step(state);
+    }
+};
+
+// For policies that always come up with a move (ie: end in NotSuicidal).
+template <typename Policy>
+inline Direction policyMove(GameState &state)
+{
+    return Policy::step(state).value;
+}
+
+typedef FirstOf<BestFood, ChaseTail, NotSuicidal> CautiousPolicy;
+typedef FirstOf<ClosestFood, NotSuicidal> HungryPolicy;
+typedef FirstOf<ChaseTail, NotSuicidal> DogPolicy;
+typedef FirstOf<KillTunnel<2>, ClosestFood, NotSuicidal> TerminatorPolicy;
+
+// Move for one of the built in policies. Custom isn't one so it gets
+// Cautious's.
+inline Direction policyMove(PolicyKind kind, GameState &state)
+{
+    switch (kind)
+    {
+        case PolicyKind::Hungry: return policyMove<HungryPolicy>(state);
+        case PolicyKind::Dog: return policyMove<DogPolicy>(state);
+        case PolicyKind::Terminator: return policyMove<TerminatorPolicy>(state);
+        default: return policyMove<CautiousPolicy>(state);
+    }
+}
+
+// Runs the algorithm's policy directly if it has one (`kind` should come
+// from its policyKind()), otherwise asks the algorithm.
+inline Direction policyMove(
+    PolicyKind kind,
+    Algorithm *algorithm,
+    GameState &state,
+    PolicyState &policyState)
+{
+    return kind == PolicyKind::Custom
+        ? algorithm->move(state, policyState)
+        : policyMove(kind, state);
+}
@@ -0,0 +1,108 @@
+#include "rollout.hpp"
+
+FoodDistanceField::FoodDistanceField() : _width(0), _height(0)
+{ }
+
+void FoodDistanceField::update(GameState &state)
+{
+    if (!_distances.empty()
+        && _width == state.width()
+        && _height == state.height()
+        && _food == state.food())
+    {
+        return;
+    }
+
+    _food = state.food();
+    _width = state.width();
+    _height = state.height();
+    _distances.assign(_width * _height, NO_FOOD_DISTANCE);
+
+    // Breadth first from every food at once.
+    std::vector<Point> queue;
+    for (Point food : _food)
+    {
+        if (!outOfBounds(food, state))
+        {
+            _distances[cellIndex(food, _width)] = 0;
+            queue.push_back(food);
+        }
+    }
+
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        Point p = queue[i];
+        uint32_t next = _distances[cellIndex(p, _width)] + 1;
+        for (Direction dir : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+        {
+            Point n = coordAfterMove(p, dir);
+            if (outOfBounds(n, state))
+                continue;
+
+            uint32_t &d = _distances[cellIndex(n, _width)];
+            if (d == NO_FOOD_DISTANCE)
+            {
+                d = next;
+                queue.push_back(n);
+            }
+        }
+    }
+}
+
+uint32_t FoodDistanceField::at(Point p, GameState &state)
+{
+    return outOfBounds(p, state)
+        ? NO_FOOD_DISTANCE
+        : _distances[cellIndex(p, _width)];
+}
+
+bool nextToBiggerHead(GameState &state, Snake *snake, Point p)
+{
+    for (auto &pair : state.snakes())
+    {
+        Snake *other = pair.second;
+        if (other != snake
+            && other->length() >= snake->length()
+            && distance(other->head(), p) == 1)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Direction cheapRolloutMove(
+    GameState &state, Snake *snake, FoodDistanceField &field)
+{
+    Point head = snake->head();
+    Direction best = Direction::Up;
+    bool found = false;
+    bool bestRisky = true;
+    uint32_t bestDistance = NO_FOOD_DISTANCE;
+
+    for (Direction dir : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+    {
+        Point p = coordAfterMove(head, dir);
+        bool isNeck = snake->length() > 1 && snake->parts.at(1) == p;
+        if (outOfBounds(p, state)
+            || state.map().turnsUntilVacant(p) > 0
+            || isNeck)
+            continue;
+
+        bool risky = nextToBiggerHead(state, snake, p);
+        uint32_t d = field.at(p, state);
+        bool better = !found
+            || (bestRisky && !risky)
+            || (bestRisky == risky && d < bestDistance);
+
+        if (better)
+        {
+            best = dir;
+            found = true;
+            bestRisky = risky;
+            bestDistance = d;
+        }
+    }
+
+    return best;
+}
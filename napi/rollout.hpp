@@ -0,0 +1,33 @@
+#pragma once
+
+#include "snakelib.hpp"
+
+// Distance for cells when there's no food at all.
+#define NO_FOOD_DISTANCE UINT32_MAX
+
+// Distance from every cell to the closest food, ignoring snakes. Only gets
+// rebuilt when the food changes so looking up a cell is all a move costs.
+class FoodDistanceField
+{
+public:
+    FoodDistanceField();
+
+    void update(GameState &state);
+    uint32_t at(Point p, GameState &state);
+
+private:
+    std::vector<Point> _food;
+    std::vector<uint32_t> _distances;
+    uint32_t _width;
+    uint32_t _height;
+};
+
+// Whether a snake at least as long as this one could move into p next turn.
+bool nextToBiggerHead(GameState &state, Snake *snake, Point p);
+
+// Cheap policy for deep rollout turns where the full algorithms cost too much
+// to be worth it: a safe move (avoiding heads that could eat it when it can)
+// towards the closest food. Only looks at the four neighbouring cells so it
+// doesn't need its own perspective of the state.
+Direction cheapRolloutMove(
+    GameState &state, Snake *snake, FoodDistanceField &field);
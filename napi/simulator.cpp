@@ -1,12 +1,52 @@
 #include "simulator.hpp"
 #include "movement.hpp"
+#include "log.hpp"
+#include "matrixgame.hpp"
+#include "evaluator.hpp"
+#include "leaf.hpp"
 #include <cmath>
 #include <sstream>
 #include <numeric>
 
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
 #define IDEAL_HEALTH_AT_FOOD_TIME 100
 
+// How much weight runSimulationBranches gives to arms that haven't had many
+// turns yet versus arms that look good so far.
+#define BANDIT_EXPLORATION 1.0
+
+// Marks a simulation that hasn't merged into another one.
+#define NO_LEADER SIZE_MAX
+
+// An arm only gets pruned in favour of one that has survived at least this
+// long everywhere. Any less and bestMove() might give up on the worst cases
+// (under 1500 points) and go by the best cases instead, which pruning would
+// have cut short.
+#define PRUNE_SAFE_TURNS 15
+
+// Number of simulated turns between looking for arms to prune.
+#define PRUNE_CHECK_INTERVAL 64
+
+// Rounds of regret matching when solving the game in bestMove. A few
+// hundred microseconds for the usual number of options.
+#define BEST_MOVE_SOLVER_ITERATIONS 1000
+
+// Score at which a future is worth 63% of surviving for sure (see
+// futureUtility). 100 points is about one turn survived.
+#define BEST_MOVE_UTILITY_SCALE 1000.0
+
+// Below this score (about 15 turns survived) an outcome is probably fatal.
+#define BEST_MOVE_DESPERATE_SCORE 1500
+
+// Options whose utility against the enemies' equilibrium mix is this close
+// are treated as a tie.
+#define BEST_MOVE_VALUE_EPSILON 0.001
+
 std::vector<std::unique_ptr<SimThread>> SimThread::instances;
+SimThreadOptions SimThread::options = { 0, false };
 
 AlgorithmPair PrefixedAlgorithmPair::unprefixed()
 {
@@ -22,17 +62,52 @@ std::string fakeGameId()
     return ss.str();
 }
 
+Latch::Latch(uint32_t count) : _count(count)
+{ }
+
+void Latch::countDown()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_count > 0 && --_count == 0)
+    {
+        _allDone.notify_all();
+    }
+}
+
+void Latch::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _allDone.wait(lock, [this]() { return _count == 0; });
+}
+
+bool Latch::waitUntil(Clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _allDone.wait_until(lock, deadline, [this]() { return _count == 0; });
+}
+
+bool Latch::done()
+{
+    return _count == 0;
+}
+
 SimThread::SimThread() :
+    _latch(nullptr),
     _hasWork(false),
     _quit(false),
-    _thread(&SimThread::spin, this),
-    _timeOfLastWork(Clock::now()),
-    _sleeping(true)
+    _thread(&SimThread::spin, this)
 { }
 
+void finishActiveBatch();
+std::vector<Future> workOnSearch(SimParams &params, SimulatorMetrics *metrics);
+
 void SimThread::stopAll()
 {
-    std::cout << "Waiting for simulation threads to stop...\n";
+    LOG(LogLevel::Info) << "Waiting for simulation threads to stop...";
+
+    // Stop anything still running in the background (eg: pondering) and take
+    // its results now so that its handle never needs the threads again.
+    finishActiveBatch();
 
     for (std::unique_ptr<SimThread> &simThread : SimThread::instances)
     {
@@ -51,25 +126,39 @@ void SimThread::startAll()
 {
     if (SimThread::instances.empty())
     {
-        unsigned cores = std::thread::hardware_concurrency();
-        std::cout << "Starting " << cores << " simulation threads" << std::endl;
-        for (unsigned i = 0; i < cores; i++)
+        unsigned cores = std::max(std::thread::hardware_concurrency(), 1U);
+
+        // Pinning only leaves a core free if there's more than one.
+        bool pin = options.pin && cores > 1;
+        unsigned threads = options.threads > 0
+            ? options.threads
+            : (pin ? cores - 1 : cores);
+
+        LOG(LogLevel::Info) << "Starting " << threads << " simulation threads"
+            << (pin ? " (pinned)" : "");
+        for (unsigned i = 0; i < threads; i++)
         {
             instances.push_back(std::make_unique<SimThread>());
+            if (pin && !instances.back()->pinTo(1 + i % (cores - 1)))
+            {
+                LOG(LogLevel::Warning) << "Couldn't pin simulation thread " << i;
+            }
         }
     }
 }
 
-void SimThread::wakeAll()
+bool SimThread::pinTo(unsigned core)
 {
-    // Call this just in case it hasn't already been called. It does nothing
-    // after the first time.
-    SimThread::startAll();
-
-    for (std::unique_ptr<SimThread> &simThread : SimThread::instances)
-    {
-        simThread->wakeUp();
-    }
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(
+        _thread.native_handle(), sizeof(cpu_set_t), &set) == 0;
+#else
+    (void)core;
+    return false;
+#endif
 }
 
 std::vector<Future> &SimThread::result()
@@ -77,6 +166,11 @@ std::vector<Future> &SimThread::result()
     return _result;
 }
 
+SimulatorMetrics &SimThread::metrics()
+{
+    return _metrics;
+}
+
 bool SimThread::done()
 {
     return !_hasWork;
@@ -84,7 +178,9 @@ bool SimThread::done()
 
 void SimThread::kill()
 {
+    std::lock_guard<std::mutex> lock(_mutex);
     _quit = true;
+    _wake.notify_one();
 }
 
 void SimThread::join()
@@ -92,62 +188,56 @@ void SimThread::join()
     _thread.join();
 }
 
-void SimThread::wakeUp()
-{
-    _sleeping = false;
-}
-
-void SimThread::sleep()
+void SimThread::startWork(SimParams params, Latch *latch)
 {
-    _sleeping = true;
+    std::lock_guard<std::mutex> lock(_mutex);
+    _params = std::move(params);
+    _job = nullptr;
+    _latch = latch;
+    _hasWork = true;
+    _wake.notify_one();
 }
 
-void SimThread::startWork(SimParams params)
+void SimThread::startJob(std::function<void()> job, Latch *latch)
 {
-    _params = std::move(params);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _job = std::move(job);
+    _latch = latch;
     _hasWork = true;
+    _wake.notify_one();
 }
 
 void SimThread::spin()
 {
-    while (!_quit)
+    while (true)
     {
-        if (_hasWork)
         {
-            if (_sleeping)
-            {
-                wakeUp();
-            }
-
-            _result = runSimulationBranches(
-                _params.branches,
-                *_params.state,
-                _params.maxTurns,
-                _params.maxMillis);
-            _hasWork = false;
-            _timeOfLastWork = Clock::now();
+            // Block (rather than spin) until there's either work to do or
+            // it's time to shut down so that idle threads cost nothing.
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this]() { return _hasWork || _quit; });
         }
-        else if (!_sleeping)
+
+        if (_quit)
         {
-            auto now = Clock::now();
-            Seconds diff = now - _timeOfLastWork;
-            if (diff > Seconds(SECONDS_OF_NO_WORK_UNTIL_SLEEP))
-            {
-                sleep();
-            }
+            break;
         }
 
-        if (_sleeping)
+        if (_job)
         {
-            // Play very nice with other threads and take very little CPU
-            std::this_thread::sleep_for(
-                std::chrono::milliseconds(SLEEP_MODE_DELAY_MILLIS));
+            _result.clear();
+            _metrics = SimulatorMetrics();
+            _job();
         }
         else
         {
-            // Play nice with other threads but take a lot of CPU
-            std::this_thread::yield();
+            _metrics = SimulatorMetrics();
+            _result = workOnSearch(_params, &_metrics);
         }
+
+        Latch *latch = _latch;
+        _hasWork = false;
+        latch->countDown();
     }
 }
 
@@ -158,11 +248,73 @@ std::string terminationReasonToString(TerminationReason reason)
         case TerminationReason::Loss: return "Loss";
         case TerminationReason::MaxTurns: return "MaxTurns";
         case TerminationReason::OutOfTime: return "OutOfTime";
+        case TerminationReason::Pruned: return "Pruned";
         default: return "Unknown";
     }
 }
 
-std::string prefixToString(std::vector<Direction> &prefix)
+void SimulatorMetrics::add(const SimulatorMetrics &other)
+{
+    threads += other.threads;
+    branches += other.branches;
+    turns += other.turns;
+    seconds += other.seconds;
+    policySeconds += other.policySeconds;
+    rulesSeconds += other.rulesSeconds;
+    stateSeconds += other.stateSeconds;
+    for (size_t i = 0; i < terminations.size(); i++)
+    {
+        terminations[i] += other.terminations[i];
+    }
+}
+
+double SimulatorMetrics::turnsPerSecondPerThread() const
+{
+    return seconds > 0.0 ? turns / seconds : 0.0;
+}
+
+void SimulatorMetrics::prettyPrint() const
+{
+    double sampled = policySeconds + rulesSeconds + stateSeconds;
+    auto percent = [sampled](double part)
+    {
+        return sampled > 0.0 ? static_cast<int>(100.0 * part / sampled) : 0;
+    };
+
+    std::cout << "Simulator: branches=" << branches
+        << " turns=" << turns
+        << " threads=" << threads
+        << " turns/s/thread=" << static_cast<uint64_t>(turnsPerSecondPerThread())
+        << std::endl;
+    std::cout << "  time: policy=" << percent(policySeconds) << "%"
+        << " rules=" << percent(rulesSeconds) << "%"
+        << " state=" << percent(stateSeconds) << "%"
+        << std::endl;
+    std::cout << "  terminations:";
+    for (size_t i = 0; i < terminations.size(); i++)
+    {
+        std::cout << " " << terminationReasonToString(static_cast<TerminationReason>(i))
+            << "=" << terminations[i];
+    }
+    std::cout << std::endl;
+}
+
+static std::mutex latestMetricsMutex;
+static SimulatorMetrics latestMetrics;
+
+void publishSimulatorMetrics(const SimulatorMetrics &metrics)
+{
+    std::lock_guard<std::mutex> lock(latestMetricsMutex);
+    latestMetrics = metrics;
+}
+
+SimulatorMetrics latestSimulatorMetrics()
+{
+    std::lock_guard<std::mutex> lock(latestMetricsMutex);
+    return latestMetrics;
+}
+
+std::string prefixToString(const std::vector<Direction> &prefix)
 {
     std::stringstream ss;
     ss << "[";
@@ -176,8 +328,9 @@ std::string prefixToString(std::vector<Direction> &prefix)
     return ss.str();
 }
 
-void Future::prettyPrint()
+void Future::prettyPrint(const BranchTable &branches)
 {
+    const AlgorithmBranch &source = branches.at(branch);
     std::cout << "Future: myAlgo=" << source.pair.myAlgorithm->meta().name
         << " turns=" << turns
         << " move=" << directionToString(move)
@@ -185,66 +338,96 @@ void Future::prettyPrint()
         << " termination=" << terminationReasonToString(terminationReason)
         << std::endl;
 
-    if (!obituaries.empty())
+    std::cout << "  obituaries:";
+    for (size_t slot = 0; slot < MAX_SNAKES; slot++)
     {
-        std::cout << "  obituaries:";
-        for (auto it : obituaries)
+        if (deathTurn[slot] != NEVER)
         {
-            std::cout << " " << it.first << "=" << it.second;
+            std::cout << " " << slot << "=" << deathTurn[slot];
         }
-        std::cout << std::endl;
     }
+    std::cout << std::endl;
 
-    if (!foodsEaten.empty())
+    std::cout << "  first food:";
+    for (size_t slot = 0; slot < MAX_SNAKES; slot++)
     {
-        std::cout << "  food:";
-        for (auto it : foodsEaten)
+        if (firstFoodTurn[slot] != NEVER)
         {
-            auto turns = it.second;
-            if (!turns.empty())
-            {
-                std::cout << " " << it.first << "=[";
-                std::string sep = "";
-                for (auto t : turns)
-                {
-                    std::cout << sep << t;
-                    sep = ",";
-                }
-                std::cout << "]";
-            }
+            std::cout << " " << slot << "=" << firstFoodTurn[slot];
         }
-        std::cout << std::endl;
     }
+    std::cout << std::endl;
 }
 
 Simulation::Simulation(
-    AlgorithmBranch branch,
+    const AlgorithmBranch &branch,
     uint32_t branchId,
     GameState &initialState,
     uint32_t maxTurns,
-    uint32_t maxMillis,
     uint32_t simNumber,
-    AxisBias bias)
+    AxisBias bias,
+    SimulatorMetrics *metrics)
     :
     _branch(branch),
     _branchId(branchId),
     _initialState(initialState),
     _maxTurns(maxTurns),
-    _maxMillis(maxMillis),
     _simNumber(simNumber),
     _enemyPathfindingBias(bias),
+    _myPolicy(branch.pair.myAlgorithm->policyKind()),
+    _enemyPolicy(branch.pair.enemyAlgorithm->policyKind()),
     _turn(0),
-    _result(
-        {{}, {}, TerminationReason::Unknown, Direction::Left, 0, branch})
-{ }
+    _history(initialState.hash()),
+    _metrics(metrics),
+    _result({ {}, {}, TerminationReason::Unknown, Direction::Left, 0, branchId, 0, 0 })
+{
+    _result.deathTurn.fill(NEVER);
+    _result.firstFoodTurn.fill(NEVER);
+}
+
+// Adds the time since the last lap to one of the SimulatorMetrics buckets,
+// but only on the turns that are being sampled.
+class TurnTimer
+{
+public:
+    TurnTimer(bool enabled) :
+        _enabled(enabled),
+        _last(enabled ? Clock::now() : Clock::time_point())
+    { }
+
+    void lap(double &bucket)
+    {
+        if (!_enabled)
+            return;
+
+        Clock::time_point now = Clock::now();
+        bucket += Seconds(now - _last).count();
+        _last = now;
+    }
+
+private:
+    bool _enabled;
+    Clock::time_point _last;
+};
 
 bool Simulation::next()
 {
     _turn++;
     GameState &currentState = _newestState ? *_newestState : _initialState;
 
+    SimulatorMetrics unused;
+    SimulatorMetrics &metrics = _metrics ? *_metrics : unused;
+    // Staggered by simulation so that short simulations get sampled too.
+    TurnTimer timer(
+        _metrics && (_simNumber + _turn) % METRICS_SAMPLE_INTERVAL == 0);
+
+    if (isCheapTurn())
+    {
+        _foodField.update(currentState);
+    }
+
     // My move.
-    auto myMoveDir = getMyMove(currentState, _branchId);
+    auto myMoveDir = getMyMove(currentState);
     SnakeMove myMove = { currentState.mySnake(), myMoveDir };
     std::vector<SnakeMove> moves { myMove };
     if (_result.turns == 0)
@@ -256,24 +439,45 @@ bool Simulation::next()
     // Enemy moves.
     for (Snake *enemy : currentState.enemies())
     {
+        if (isCheapTurn())
+        {
+            moves.push_back(
+                { enemy, cheapRolloutMove(currentState, enemy, _foodField) });
+            continue;
+        }
+
+        timer.lap(metrics.policySeconds);
         GameState &enemyState = currentState.perspective(
             enemy, _enemyPathfindingBias);
-
-        // Add bug number to branch id so it won't conflict with my move's
-        // branch id. It's a hack for when both use same algorithm and they
-        // need to be treated as their own instances.
-        Direction direction = _branch.pair.enemyAlgorithm->move(
-            enemyState, _branchId + 100000);
+        timer.lap(metrics.stateSeconds);
+
+        // Every snake has its own policy state so it doesn't matter if the
+        // same algorithm is playing more than one of them.
+        Direction direction = policyMove(
+            _enemyPolicy,
+            _branch.pair.enemyAlgorithm,
+            enemyState,
+            policyState(enemy));
         moves.push_back({ enemy, direction });
     }
 
+    timer.lap(metrics.policySeconds);
+
+    // Same as newStateAfterMoves() but split up so each part can be timed.
+    World nextWorld = currentState.world();
+    timer.lap(metrics.stateSeconds);
+    applyMoves(nextWorld, moves);
+    timer.lap(metrics.rulesSeconds);
     std::unique_ptr<GameState> newState =
-        currentState.newStateAfterMoves(moves);
+        std::make_unique<GameState>(nextWorld);
+    timer.lap(metrics.stateSeconds);
 
     updateObituaries(*newState, currentState);
     updateFoodsEaten(*newState, currentState);
+    timer.lap(metrics.rulesSeconds);
 
     _newestState = std::move(newState);
+    _history = _history * 1099511628211ULL ^ _newestState->hash();
 
     if (_newestState->isLoss())
     {
@@ -285,164 +489,1020 @@ bool Simulation::next()
 }
 
 TerminationReason coerceTerminationReason(
-    TerminationReason current, uint32_t turn, uint32_t maxTurns)
+    TerminationReason current, uint32_t turn, uint32_t maxTurns, bool pruned)
 {
     if (current == TerminationReason::Unknown)
     {
-        return turn >= maxTurns
-            ? TerminationReason::MaxTurns
+        if (turn >= maxTurns)
+            return TerminationReason::MaxTurns;
+
+        return pruned
+            ? TerminationReason::Pruned
             : TerminationReason::OutOfTime;
     }
     return current;
 }
 
-std::vector<Future> runSimulationBranches(
-    std::vector<AlgorithmBranch> &branches,
-    GameState &initialState,
+// A group of simulations that all start with the same algorithm and prefix
+// for my snake. These are the choices that bestMove() ends up comparing so
+// they're what simulation time gets divided between.
+struct Arm
+{
+    Algorithm *algorithm;
+    std::vector<Direction> firstMoves;
+    std::vector<size_t> simulations;
+    uint32_t pulls;
+    bool anyLoss;
+    uint32_t earliestLoss;
+    bool pruned;
+
+    // Simulations that aren't finished and the ones of those that some
+    // thread is in the middle of a turn for.
+    uint32_t live;
+    uint32_t running;
+};
+
+std::vector<Arm> groupIntoArms(
+    const BranchTable &branches, const std::vector<uint32_t> &ids)
+{
+    std::vector<Arm> arms;
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        const AlgorithmBranch &branch = branches[ids[i]];
+        auto it = std::find_if(arms.begin(), arms.end(), [&branch](Arm &arm)
+            {
+                return arm.algorithm == branch.pair.myAlgorithm
+                    && arm.firstMoves == branch.firstMoves;
+            });
+
+        if (it == arms.end())
+        {
+            arms.push_back({
+                branch.pair.myAlgorithm, branch.firstMoves, { i }, 0, false, 0,
+                false, 1, 0 });
+        }
+        else
+        {
+            it->simulations.push_back(i);
+            it->live++;
+        }
+    }
+    return arms;
+}
+
+// Whether an arm that has lost shares its first move with one that hasn't
+// and whose every simulation is in the middle of a turn on another thread.
+// The next of those turns to finish could get the lost arm pruned (see
+// BranchSearch::pruneDominatedArms), so it's better to wait for them than to
+// play the lost arm on in the meantime.
+bool mightBePrunedSoon(std::vector<Arm> &arms, const Arm &arm)
+{
+    if (!arm.anyLoss || arm.firstMoves.empty())
+        return false;
+
+    for (Arm &other : arms)
+    {
+        if (&other != &arm
+            && !other.pruned
+            && !other.anyLoss
+            && other.running > 0
+            && other.live == other.running
+            && !other.firstMoves.empty()
+            && other.firstMoves.front() == arm.firstMoves.front())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// UCB1 over the arms. An arm's value is how long it's known to keep me alive
+// in its worst case so far (relative to the deepest any simulation has gone),
+// and arms with no known loss count as perfect. Arms that already lose early
+// can't win the decision so they get fewer turns, but the exploration term
+// makes sure they're never starved completely. Arms with nothing that isn't
+// already running somewhere can't be picked, and neither can ones that
+// might be about to get pruned.
+int pickArm(
+    std::vector<Arm> &arms,
+    uint32_t totalPulls,
+    uint32_t deepestTurn)
+{
+    int best = -1;
+    double bestIndex = 0.0;
+    double logPulls = std::log(static_cast<double>(totalPulls + 1));
+
+    for (size_t a = 0; a < arms.size(); a++)
+    {
+        Arm &arm = arms[a];
+        if (arm.live == arm.running || mightBePrunedSoon(arms, arm))
+            continue;
+
+        double value = arm.anyLoss
+            ? static_cast<double>(arm.earliestLoss) / std::max(deepestTurn, 1U)
+            : 1.0;
+        double exploration = BANDIT_EXPLORATION * std::sqrt(
+            logPulls / (arm.pulls + 1));
+        double index = value + exploration;
+
+        if (best < 0 || index > bestIndex)
+        {
+            best = a;
+            bestIndex = index;
+        }
+    }
+
+    return best;
+}
+
+// Everything that decides how a simulation plays out from its current turn
+// on. Two simulations with equal keys will end up the same from here so only
+// one of them needs to keep going.
+struct ConvergenceKey
+{
+    uint64_t stateHash;
+    uint64_t history;
+    uint32_t turn;
+    Algorithm *myAlgorithm;
+    Algorithm *enemyAlgorithm;
+    AxisBias bias;
+    uint32_t expensiveTurns;
+    std::vector<Direction> remainingPrefix;
+
+    bool operator==(const ConvergenceKey &other) const
+    {
+        return stateHash == other.stateHash
+            && expensiveTurns == other.expensiveTurns
+            && history == other.history
+            && turn == other.turn
+            && myAlgorithm == other.myAlgorithm
+            && enemyAlgorithm == other.enemyAlgorithm
+            && bias == other.bias
+            && remainingPrefix == other.remainingPrefix;
+    }
+};
+
+struct ConvergenceKeyHash
+{
+    size_t operator()(const ConvergenceKey &key) const
+    {
+        return key.stateHash ^ (key.history * 31) ^ key.turn;
+    }
+};
+
+ConvergenceKey convergenceKey(Simulation &sim)
+{
+    const AlgorithmBranch &branch = sim.branch();
+    GameState &state = sim.state();
+    uint32_t turn = sim.turn();
+
+    ConvergenceKey key {
+        state.hash(), 0, turn, branch.pair.myAlgorithm, nullptr,
+        AxisBias::Vertical, branch.expensiveTurns, {}
+    };
+
+    if (turn < branch.firstMoves.size())
+    {
+        key.remainingPrefix.assign(
+            branch.firstMoves.begin() + turn, branch.firstMoves.end());
+    }
+
+    // Once every turn left is played by cheapRolloutMove() the algorithms
+    // make no difference at all.
+    if (turn >= branch.expensiveTurns)
+    {
+        key.myAlgorithm = nullptr;
+        key.expensiveTurns = 0;
+        return key;
+    }
+
+    // Enemy algorithm and bias don't matter once the enemies are all dead.
+    bool needsHistory = branch.pair.myAlgorithm->hasBranchState();
+    if (!state.enemies().empty())
+    {
+        key.enemyAlgorithm = branch.pair.enemyAlgorithm;
+        key.bias = branch.enemyPathBindingBias;
+        needsHistory = needsHistory || branch.pair.enemyAlgorithm->hasBranchState();
+    }
+
+    // Algorithms that remember things per branch only agree if they've seen
+    // exactly the same states the whole way.
+    if (needsHistory)
+    {
+        key.history = sim.history();
+    }
+
+    return key;
+}
+
+// Result for a simulation that merged into `leader` after `turn` turns: its
+// own events up to then and the leader's from then on.
+Future followLeader(Future own, Future &leader, uint32_t turn)
+{
+    for (size_t slot = 0; slot < MAX_SNAKES; slot++)
+    {
+        if (leader.deathTurn[slot] != NEVER && leader.deathTurn[slot] > turn)
+        {
+            own.deathTurn[slot] = leader.deathTurn[slot];
+        }
+
+        if (own.firstFoodTurn[slot] == NEVER
+            && leader.firstFoodTurn[slot] != NEVER
+            && leader.firstFoodTurn[slot] > turn)
+        {
+            own.firstFoodTurn[slot] = leader.firstFoodTurn[slot];
+        }
+    }
+
+    own.terminationReason = leader.terminationReason;
+    own.turns = leader.turns;
+    own.evaluation = leader.evaluation;
+    own.leafScore = leader.leafScore;
+    return own;
+}
+
+// What the evaluator makes of the state a simulation ended in, in
+// scoreFuture() points.
+uint16_t evaluateLastState(GameState &state)
+{
+    Evaluator &evaluator = Evaluator::shared();
+    if (!evaluator.loaded() || state.mySnake() == nullptr)
+        return 0;
+
+    float chance = evaluator.evaluate(state, state.mySnake());
+    return static_cast<uint16_t>(std::lround(chance * EVALUATOR_SCORE_WEIGHT));
+}
+
+// The simulator doesn't keep track of health so this is a guess at mine at
+// the end of a future: one less each turn since I last ate, taking the first
+// food as the last.
+uint32_t estimatedHealth(const Future &future, GameState &initialState)
+{
+    Snake *me = initialState.mySnake();
+    uint32_t slot = me->slot;
+    uint32_t hungryTurns = future.turns;
+    uint32_t health = me->health;
+    if (slot < MAX_SNAKES && future.firstFoodTurn[slot] != NEVER)
+    {
+        hungryTurns = future.turns - std::min<uint32_t>(future.turns, future.firstFoodTurn[slot]);
+        health = 100;
+    }
+    return health > hungryTurns ? health - hungryTurns : 0;
+}
+
+// The simulations for one set of branches and all the bookkeeping that
+// decides which of them gets the next turn. Every SimThread works on the
+// same search so the bandit, pruning and convergence see every arm in the
+// batch, and a thread whose last simulation finished just carries on with
+// whichever arm is best rather than sitting idle.
+class BranchSearch
+{
+public:
+    BranchSearch(
+        const BranchTable &branches,
+        const std::vector<uint32_t> &ids,
+        uint32_t maxTurns,
+        bool horizon,
+        uint32_t workers);
+
+    // Runs turns until the deadline, cancellation or there's nothing left to
+    // simulate. Each worker passes its own copy of the initial state since
+    // GameState caches things as it's used, so it can't be shared between
+    // threads. The last worker to finish gets the futures, the rest get none.
+    std::vector<Future> work(
+        GameState &initialState,
+        Deadline deadline,
+        std::atomic<bool> *cancelled,
+        SimulatorMetrics *metrics);
+
+private:
+    // What a turn found out, worked out before taking the lock again.
+    struct Step
+    {
+        bool lost;
+        uint32_t turn;
+        bool converges;
+        ConvergenceKey key;
+    };
+
+    Step advance(size_t i, SimulatorMetrics *metrics);
+    void claim(size_t i);
+    void record(size_t i, Step &step);
+    void complete(size_t i);
+    void scoreStopped(std::unique_lock<std::mutex> &lock, GameState &initialState);
+    uint32_t survived(size_t i);
+    void pruneDominatedArms();
+    std::vector<Future> results();
+
+    const BranchTable &_branches;
+    std::vector<uint32_t> _ids;
+    uint32_t _maxTurns;
+    bool _horizon;
+
+    std::mutex _mutex;
+    std::condition_variable _stepped;
+    uint32_t _workersLeft;
+    uint32_t _waiting;
+
+    // Simulations are made by whichever worker gives them their first turn
+    // so that they start from that worker's copy of the state.
+    std::vector<std::unique_ptr<Simulation>> _simulations;
+    size_t _started;
+    std::vector<uint32_t> _turns;
+    std::vector<bool> _running;
+    std::vector<bool> _completed;
+    size_t _live;
+
+    std::vector<Arm> _arms;
+    std::vector<size_t> _armOf;
+    uint32_t _totalPulls;
+    uint32_t _deepestTurn;
+
+    // Simulations that converged with another one stop and take the rest of
+    // their result from that one (their leader).
+    std::unordered_map<ConvergenceKey, size_t, ConvergenceKeyHash> _leaders;
+    std::vector<size_t> _leaderOf;
+    std::vector<uint32_t> _mergedAt;
+
+    // Turn each simulation lost on (0 if it hasn't) and which ones were
+    // stopped because they can't change the decision anymore. Pruning is
+    // looked at every so often, and straight away after a loss or a
+    // simulation reaching PRUNE_SAFE_TURNS since either can be the thing it
+    // was waiting for.
+    std::vector<uint32_t> _lostAt;
+    std::vector<bool> _pruned;
+    bool _pruneCheckDue;
+    uint32_t _nextPruneCheck;
+
+    // How the state each simulation stopped in looks, worked out by the
+    // worker that stopped it (see scoreStopped) rather than all at the end.
+    // Followers don't get one since they take their leader's.
+    std::vector<size_t> _toScore;
+    std::vector<uint16_t> _evaluations;
+    std::vector<int32_t> _leafScores;
+};
+
+BranchSearch::BranchSearch(
+    const BranchTable &branches,
+    const std::vector<uint32_t> &ids,
     uint32_t maxTurns,
-    uint32_t maxMillis)
+    bool horizon,
+    uint32_t workers)
+    :
+    _branches(branches),
+    _ids(ids),
+    _maxTurns(maxTurns),
+    _horizon(horizon),
+    _workersLeft(workers),
+    _waiting(0),
+    _simulations(ids.size()),
+    _started(0),
+    _turns(ids.size(), 0),
+    _running(ids.size(), false),
+    _completed(ids.size(), false),
+    _live(ids.size()),
+    _arms(groupIntoArms(branches, ids)),
+    _armOf(ids.size()),
+    _totalPulls(0),
+    _deepestTurn(0),
+    _leaderOf(ids.size(), NO_LEADER),
+    _mergedAt(ids.size(), 0),
+    _lostAt(ids.size(), 0),
+    _pruned(ids.size(), false),
+    _pruneCheckDue(false),
+    _nextPruneCheck(PRUNE_CHECK_INTERVAL),
+    _evaluations(ids.size(), 0),
+    _leafScores(ids.size(), 0)
 {
-    auto start = Clock::now();
-    auto maxSeconds = Seconds(static_cast<double>(maxMillis) / 1000.0);
-    uint32_t turn = 0;
-    std::vector<Simulation> simulations;
-    uint32_t simIndex = 0;
-    std::vector<Future> results;
-    uint32_t nextId = 1;
+    for (size_t a = 0; a < _arms.size(); a++)
+    {
+        for (size_t i : _arms[a].simulations)
+        {
+            _armOf[i] = a;
+        }
+    }
+}
+
+// Must hold _mutex.
+void BranchSearch::claim(size_t i)
+{
+    Arm &arm = _arms[_armOf[i]];
+    _running[i] = true;
+    arm.running++;
+    arm.pulls++;
+    _totalPulls++;
+}
+
+// Runs without the lock. Nothing else touches a simulation while it's
+// claimed.
+BranchSearch::Step BranchSearch::advance(size_t i, SimulatorMetrics *metrics)
+{
+    Simulation &sim = *_simulations[i];
+    sim.setMetrics(metrics);
+    Step step { sim.next(), sim.turn(), false, {} };
+    if (!step.lost && step.turn < _maxTurns)
+    {
+        step.converges = true;
+        step.key = convergenceKey(sim);
+    }
+    return step;
+}
+
+// Must hold _mutex.
+void BranchSearch::complete(size_t i)
+{
+    if (_completed[i])
+        return;
+
+    _completed[i] = true;
+    _arms[_armOf[i]].live--;
+    _live--;
+    if (_leaderOf[i] == NO_LEADER)
+    {
+        _toScore.push_back(i);
+    }
+}
+
+// Scores everything that has stopped since last time, letting go of the lock
+// while it does so other workers can carry on. Must hold _mutex.
+void BranchSearch::scoreStopped(std::unique_lock<std::mutex> &lock, GameState &initialState)
+{
+    while (!_toScore.empty())
+    {
+        size_t i = _toScore.back();
+        _toScore.pop_back();
+        Simulation &sim = *_simulations[i];
+        Future result = sim.result();
+        result.terminationReason = coerceTerminationReason(
+            result.terminationReason, sim.turn(), _maxTurns, _pruned[i]);
+        lock.unlock();
+
+        // Without a horizon only running into maxTurns counts as being cut
+        // off. With one, simulations stopped early by the deadline or pruning
+        // are judged from where they got to like the rest.
+        bool cutOff = result.terminationReason == TerminationReason::MaxTurns
+            || (_horizon && result.terminationReason != TerminationReason::Loss);
+
+        _evaluations[i] = evaluateLastState(sim.state());
+        if (cutOff)
+        {
+            _leafScores[i] = leafScore(sim.state(), estimatedHealth(result, initialState));
+        }
+        lock.lock();
+    }
+}
+
+// Must hold _mutex.
+void BranchSearch::record(size_t i, Step &step)
+{
+    Arm &arm = _arms[_armOf[i]];
+    _running[i] = false;
+    arm.running--;
+    _turns[i] = step.turn;
+    _deepestTurn = std::max(_deepestTurn, step.turn);
 
-    for (AlgorithmBranch &branch : branches)
+    if (_waiting > 0)
     {
-        AxisBias bias = branch.enemyPathBindingBias;
-        simulations.push_back(
-            { branch, nextId++, initialState, maxTurns, maxMillis, simIndex++, bias });
+        _stepped.notify_all();
+    }
 
-        results.push_back({
-            {},
-            {},
-            TerminationReason::Unknown,
-            Direction::Left,
-            0,
-            branch
-        });
+    if (step.lost)
+    {
+        arm.earliestLoss = arm.anyLoss
+            ? std::min(arm.earliestLoss, step.turn)
+            : step.turn;
+        arm.anyLoss = true;
+        _lostAt[i] = step.turn;
+        _pruneCheckDue = true;
+    }
+    else if (step.turn == PRUNE_SAFE_TURNS)
+    {
+        _pruneCheckDue = true;
+    }
+
+    // Pruned while this turn was running.
+    if (!step.converges || _pruned[i])
+    {
+        complete(i);
+        return;
+    }
+
+    auto found = _leaders.find(step.key);
+    if (found == _leaders.end())
+    {
+        _leaders.emplace(std::move(step.key), i);
+    }
+    else if (_pruned[found->second])
+    {
+        // A pruned simulation won't get any further so take its place.
+        found->second = i;
+    }
+    else
+    {
+        _leaderOf[i] = found->second;
+        _mergedAt[i] = step.turn;
+        complete(i);
     }
+}
 
-    // Keep track of simulations that are finished so we know when to stop
-    std::unordered_set<uint32_t> completedSimulations;
+// How many turns a simulation is known to survive for so far, counting
+// whatever its leader has done since they merged. Must hold _mutex.
+uint32_t BranchSearch::survived(size_t i)
+{
+    while (_leaderOf[i] != NO_LEADER)
+    {
+        i = _leaderOf[i];
+    }
+    return _lostAt[i] > 0 ? _lostAt[i] : _turns[i];
+}
 
-    bool outOfTime = false;
+// bestMove() keeps the worst case of each arm and then picks the best of
+// those. An arm that has already lost on some turn can't be picked once
+// another arm starting with the same move (so everything bestMove() scores
+// without simulating is the same for both) has outlived that turn in every
+// simulation, so the rest of its simulations are a waste. Must hold _mutex.
+void BranchSearch::pruneDominatedArms()
+{
+    std::vector<uint32_t> armSurvived(_arms.size(), UINT32_MAX);
+    for (size_t i = 0; i < _simulations.size(); i++)
+    {
+        armSurvived[_armOf[i]] = std::min(armSurvived[_armOf[i]], survived(i));
+    }
 
-    while (completedSimulations.size() < simulations.size())
+    bool anyPruned = false;
+    for (Arm &arm : _arms)
     {
-        turn++;
-        for (Simulation &sim : simulations)
+        if (arm.pruned || !arm.anyLoss || arm.firstMoves.empty())
+            continue;
+
+        for (size_t b = 0; b < _arms.size(); b++)
         {
-            // Don't do anything if this sim is already done
-            auto completedIter = completedSimulations.find(sim.simNumber());
-            if (completedIter != completedSimulations.end())
-            {
+            Arm &other = _arms[b];
+            if (&other == &arm
+                || other.pruned
+                || other.firstMoves.empty()
+                || other.firstMoves.front() != arm.firstMoves.front())
                 continue;
+
+            if (armSurvived[b] >= PRUNE_SAFE_TURNS
+                && armSurvived[b] > arm.earliestLoss)
+            {
+                arm.pruned = true;
+                anyPruned = true;
+                break;
+            }
+        }
+    }
+
+    if (!anyPruned)
+        return;
+
+    // Simulations that some live arm is following have to keep going.
+    std::vector<bool> needed(_simulations.size(), false);
+    for (size_t i = 0; i < _simulations.size(); i++)
+    {
+        if (_arms[_armOf[i]].pruned)
+            continue;
+
+        for (size_t j = _leaderOf[i]; j != NO_LEADER; j = _leaderOf[j])
+        {
+            needed[j] = true;
+        }
+    }
+
+    // Ones that are in the middle of a turn get completed when it's
+    // recorded.
+    for (size_t i = 0; i < _simulations.size(); i++)
+    {
+        if (_arms[_armOf[i]].pruned && !_completed[i] && !needed[i])
+        {
+            _pruned[i] = true;
+            if (!_running[i])
+            {
+                complete(i);
             }
+        }
+    }
+}
+
+std::vector<Future> BranchSearch::work(
+    GameState &initialState,
+    Deadline deadline,
+    std::atomic<bool> *cancelled,
+    SimulatorMetrics *metrics)
+{
+    Clock::time_point started = Clock::now();
+    uint32_t turns = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    // Every simulation gets at least one turn no matter what, otherwise there
+    // wouldn't even be a first move to choose from.
+    while (_started < _simulations.size())
+    {
+        size_t i = _started++;
+        claim(i);
+        lock.unlock();
+
+        const AlgorithmBranch &branch = _branches[_ids[i]];
+        _simulations[i] = std::make_unique<Simulation>(
+            branch, _ids[i], initialState, _maxTurns, static_cast<uint32_t>(i),
+            branch.enemyPathBindingBias, metrics);
+        Step step = advance(i, metrics);
+        turns++;
+
+        lock.lock();
+        record(i, step);
+        scoreStopped(lock, initialState);
+    }
+
+    while (_live > 0 && !deadline.expired() && !(cancelled && *cancelled))
+    {
+        if (_pruneCheckDue || _totalPulls >= _nextPruneCheck)
+        {
+            pruneDominatedArms();
+            _pruneCheckDue = false;
+            _nextPruneCheck = _totalPulls + PRUNE_CHECK_INTERVAL;
+        }
 
-            auto now = Clock::now();
-            Seconds diff = now - start;
-            outOfTime = diff >= maxSeconds;
+        int a = pickArm(_arms, _totalPulls, _deepestTurn);
+        if (a < 0)
+        {
+            // Whatever is left is in the middle of a turn on other threads
+            // (or waiting to see what one of those turns prunes) and might
+            // still need more after it.
+            _waiting++;
+            _stepped.wait_until(lock, deadline.at());
+            _waiting--;
+            continue;
+        }
+
+        // Within an arm advance whichever simulation is furthest behind so
+        // that its worst case is judged at a consistent depth.
+        size_t next = 0;
+        bool found = false;
+        for (size_t i : _arms[a].simulations)
+        {
+            if (_completed[i] || _running[i])
+                continue;
 
-            if (sim.next() || turn >= maxTurns || outOfTime)
+            if (!found || _turns[i] < _turns[next])
             {
-                results[sim.simNumber()] = sim.result();
-                completedSimulations.insert(sim.simNumber());
+                next = i;
+                found = true;
             }
         }
+
+        claim(next);
+        lock.unlock();
+        Step step = advance(next, metrics);
+        turns++;
+        lock.lock();
+        record(next, step);
+        scoreStopped(lock, initialState);
+    }
+
+    // Whatever is left ran out of time. Every worker gets here at about the
+    // same time, so scoring those gets shared out between them too.
+    for (size_t i = 0; i < _simulations.size(); i++)
+    {
+        if (!_completed[i] && !_running[i])
+        {
+            complete(i);
+            scoreStopped(lock, initialState);
+        }
+    }
+
+    if (metrics)
+    {
+        metrics->threads = 1;
+        metrics->turns = turns;
+        metrics->seconds = Seconds(Clock::now() - started).count();
+    }
+
+    if (--_workersLeft > 0)
+    {
+        return {};
+    }
+
+    lock.unlock();
+    std::vector<Future> futures = results();
+    if (metrics)
+    {
+        metrics->branches = static_cast<uint32_t>(_ids.size());
+        for (Future &future : futures)
+        {
+            metrics->terminations[static_cast<size_t>(future.terminationReason)]++;
+        }
     }
+    return futures;
+}
 
-    for (size_t i = 0; i < results.size(); i++)
+// Only once every worker has stopped.
+std::vector<Future> BranchSearch::results()
+{
+    std::vector<Future> results;
+    results.reserve(_simulations.size());
+
+    for (size_t i = 0; i < _simulations.size(); i++)
     {
-        results[i] = simulations[i].result();
-        results[i].terminationReason = coerceTerminationReason(
-            results[i].terminationReason, turn, maxTurns);
+        Simulation &sim = *_simulations[i];
+        results.push_back(sim.result());
+        Future &result = results.back();
+        result.terminationReason = coerceTerminationReason(
+            result.terminationReason, sim.turn(), _maxTurns, _pruned[i]);
+        result.evaluation = _evaluations[i];
+        result.leafScore = _leafScores[i];
     }
 
-    // std::cout << "simulated " << turn << " turns | oot: " << outOfTime
-    //     << " | branches: " << branches.size() << std::endl;
+    // Leaders can themselves have merged into something else later on so
+    // make sure each leader is finished before its followers copy from it.
+    std::vector<bool> resolved(_simulations.size(), false);
+    std::function<void(size_t)> resolve = [&](size_t i)
+    {
+        if (resolved[i])
+            return;
+
+        resolved[i] = true;
+        size_t leader = _leaderOf[i];
+        if (leader != NO_LEADER)
+        {
+            resolve(leader);
+            results[i] = followLeader(results[i], results[leader], _mergedAt[i]);
+        }
+    };
+
+    for (size_t i = 0; i < _simulations.size(); i++)
+    {
+        resolve(i);
+    }
 
     return results;
 }
 
-std::vector<Future> runSimulations(
+std::vector<Future> runSimulationBranches(
+    const BranchTable &branches,
+    GameState &initialState,
+    uint32_t maxTurns,
+    Deadline deadline,
+    std::atomic<bool> *cancelled)
+{
+    std::vector<uint32_t> ids(branches.size());
+    std::iota(ids.begin(), ids.end(), 0);
+    return runSimulationBranches(
+        branches, ids, initialState, maxTurns, deadline, cancelled);
+}
+
+std::vector<Future> runSimulationBranches(
+    const BranchTable &branches,
+    const std::vector<uint32_t> &ids,
+    GameState &initialState,
+    uint32_t maxTurns,
+    Deadline deadline,
+    std::atomic<bool> *cancelled,
+    SimulatorMetrics *metrics)
+{
+    BranchSearch search(branches, ids, maxTurns, false, 1);
+    return search.work(initialState, deadline, cancelled, metrics);
+}
+
+std::vector<Future> workOnSearch(SimParams &params, SimulatorMetrics *metrics)
+{
+    return params.search->work(
+        *params.state, params.deadline, params.cancelled, metrics);
+}
+
+// Everything the pool needs to keep alive while one set of simulations is in
+// flight. Only one batch can be on the SimThreads at a time.
+struct SimulationBatch
+{
+    SimulationBatch(size_t threads, std::shared_ptr<const BranchTable> table) :
+        latch(threads),
+        cancelled(false),
+        collected(false),
+        preemptible(false),
+        branches(table)
+    { }
+
+    // Wait for every thread to finish this batch and take its futures before
+    // the threads get reused.
+    void collect()
+    {
+        if (collected)
+            return;
+
+        latch.wait();
+        for (std::unique_ptr<SimThread> &simThread : SimThread::instances)
+        {
+            std::vector<Future> &thisResult = simThread->result();
+            futures.insert(futures.end(), thisResult.begin(), thisResult.end());
+            metrics.add(simThread->metrics());
+        }
+        collected = true;
+    }
+
+    Latch latch;
+    std::atomic<bool> cancelled;
+    bool collected;
+    bool preemptible;
+    std::shared_ptr<const BranchTable> branches;
+    std::vector<Future> futures;
+    SimulatorMetrics metrics;
+};
+
+static std::mutex activeBatchMutex;
+static std::shared_ptr<SimulationBatch> activeBatch;
+
+// Must hold activeBatchMutex.
+std::shared_ptr<SimulationBatch> startBatch(
+    std::shared_ptr<const BranchTable> branches = nullptr)
+{
+    // Whatever was on the threads before has to finish (and have its results
+    // saved) before the threads can take new work. Background work gets
+    // stopped rather than waited for.
+    if (activeBatch)
+    {
+        if (activeBatch->preemptible)
+        {
+            activeBatch->cancelled = true;
+        }
+        activeBatch->collect();
+    }
+
+    activeBatch = std::make_shared<SimulationBatch>(
+        SimThread::instances.size(), branches);
+    return activeBatch;
+}
+
+// Cancels whatever is on the threads and waits for it to finish.
+void finishActiveBatch()
+{
+    std::lock_guard<std::mutex> lock(activeBatchMutex);
+    if (activeBatch)
+    {
+        activeBatch->cancelled = true;
+        activeBatch->collect();
+    }
+}
+
+SimulationHandle::SimulationHandle()
+{ }
+
+SimulationHandle::SimulationHandle(std::shared_ptr<SimulationBatch> batch) :
+    _batch(batch)
+{ }
+
+SimulationHandle &SimulationHandle::operator=(SimulationHandle &&other)
+{
+    if (this != &other)
+    {
+        cancel();
+        get();
+        _batch = std::move(other._batch);
+    }
+    return *this;
+}
+
+SimulationHandle::~SimulationHandle()
+{
+    cancel();
+    get();
+}
+
+bool SimulationHandle::ready()
+{
+    return !_batch || _batch->latch.done();
+}
+
+bool SimulationHandle::waitUntil(Clock::time_point deadline)
+{
+    return !_batch || _batch->latch.waitUntil(deadline);
+}
+
+void SimulationHandle::makePreemptible()
+{
+    if (_batch)
+    {
+        std::lock_guard<std::mutex> lock(activeBatchMutex);
+        _batch->preemptible = true;
+    }
+}
+
+void SimulationHandle::cancel()
+{
+    if (_batch)
+    {
+        _batch->cancelled = true;
+    }
+}
+
+std::vector<Future> SimulationHandle::get()
+{
+    if (!_batch)
+    {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(activeBatchMutex);
+    _batch->collect();
+    return std::move(_batch->futures);
+}
+
+SimulatorMetrics SimulationHandle::metrics()
+{
+    if (!_batch)
+    {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(activeBatchMutex);
+    _batch->collect();
+    return _batch->metrics;
+}
+
+const BranchTable &SimulationHandle::branches()
+{
+    static const BranchTable none;
+    return _batch && _batch->branches ? *_batch->branches : none;
+}
+
+SimulationHandle runSimulationsAsync(
     std::vector<PrefixedAlgorithmPair> algorithmPairs,
     GameState &initialState,
     uint32_t maxTurns,
-    uint32_t maxMillis)
+    Deadline deadline,
+    bool horizon)
 {
-    uint32_t branchIndex = 0;
     size_t threads = SimThread::instances.size();
-    std::vector<std::vector<AlgorithmBranch>> branches(threads);
+    auto table = std::make_shared<BranchTable>();
     for (PrefixedAlgorithmPair pair : algorithmPairs)
     {
         if (pair.myAlgorithm.prefixes.empty())
         {
-            branches[branchIndex++ % threads].push_back(
-                { pair.unprefixed(), { }, AxisBias::Horizontal });
-
-            branches[branchIndex++ % threads].push_back(
-                { pair.unprefixed(), { }, AxisBias::Vertical });
+            table->push_back({ pair.unprefixed(), { }, AxisBias::Horizontal });
+            table->push_back({ pair.unprefixed(), { }, AxisBias::Vertical });
         }
 
         for (std::vector<Direction> &prefix : pair.myAlgorithm.prefixes)
         {
-            branches[branchIndex++ % threads].push_back(
-                { pair.unprefixed(), prefix, AxisBias::Horizontal });
-
-            branches[branchIndex++ % threads].push_back(
-                { pair.unprefixed(), prefix, AxisBias::Vertical });
-            // MaybeDirection maybeDir { true, firstDir };
-            //
-            // uint32_t threadIndex1 = branchIndex++ % THREAD_COUNT;
-            // AlgorithmBranch branch1{ pair, maybeDir, AxisBias::Horizontal };
-            // branches[threadIndex1].push_back(branch1);
-            //
-            // uint32_t threadIndex2 = branchIndex++ % THREAD_COUNT;
-            // AlgorithmBranch branch2{ pair, maybeDir, AxisBias::Vertical };
-            // branches[threadIndex2].push_back(branch2);
+            table->push_back({ pair.unprefixed(), prefix, AxisBias::Horizontal });
+            table->push_back({ pair.unprefixed(), prefix, AxisBias::Vertical });
         }
     }
 
+    std::vector<uint32_t> ids(table->size());
+    std::iota(ids.begin(), ids.end(), 0);
+    auto search = std::make_shared<BranchSearch>(
+        *table, ids, maxTurns, horizon, static_cast<uint32_t>(threads));
+
+    std::lock_guard<std::mutex> lock(activeBatchMutex);
+    std::shared_ptr<SimulationBatch> batch = startBatch(table);
     for (uint32_t g = 0; g < threads; g++)
     {
-        SimThread::instances[g]->startWork(
-            { branches[g], initialState.clone(), maxTurns, maxMillis });
+        SimThread::instances[g]->startWork({
+            table,
+            search,
+            initialState.clone(),
+            deadline,
+            &batch->cancelled
+        }, &batch->latch);
     }
 
-    bool anyIncomplete = true;
-    while (anyIncomplete)
-    {
-        anyIncomplete = false;
-        for (std::unique_ptr<SimThread> &simThread : SimThread::instances)
-        {
-            if (!simThread->done())
-            {
-                anyIncomplete = true;
-            }
-        }
-        std::this_thread::yield();
-    }
+    return SimulationHandle(batch);
+}
 
-    std::vector<Future> result;
-    for (std::unique_ptr<SimThread> &simThread : SimThread::instances)
+SimulationHandle runOnSimThreadsAsync(SimThreadJob job)
+{
+    std::lock_guard<std::mutex> lock(activeBatchMutex);
+    std::shared_ptr<SimulationBatch> batch = startBatch();
+    for (uint32_t g = 0; g < SimThread::instances.size(); g++)
     {
-        std::vector<Future> thisResult = simThread->result();
-        result.insert(result.end(), thisResult.begin(), thisResult.end());
+        // The batch stays alive (as the active batch) until all threads are
+        // done with it so it's ok to hang on to a raw pointer here.
+        SimulationBatch *b = batch.get();
+        SimThread::instances[g]->startJob(
+            [job, g, b]() { job(g, b->cancelled); }, &batch->latch);
     }
 
-    return result;
+    return SimulationHandle(batch);
 }
 
-std::vector<Future> simulateFutures(
+std::vector<Future> runSimulations(
+    std::vector<PrefixedAlgorithmPair> algorithmPairs,
+    GameState &initialState,
+    uint32_t maxTurns,
+    Deadline deadline)
+{
+    return runSimulationsAsync(
+        algorithmPairs, initialState, maxTurns, deadline).get();
+}
+
+SimulationHandle simulateFuturesAsync(
     GameState &initialState,
     uint32_t maxTurns,
-    uint32_t maxMillis,
+    Deadline deadline,
     std::vector<PrefixedAlgorithm> myAlgorithms,
-    std::vector<PrefixedAlgorithm> enemyAlgorithms)
+    std::vector<PrefixedAlgorithm> enemyAlgorithms,
+    bool horizon)
 {
     // Make algorithm pairs
     std::vector<PrefixedAlgorithmPair> algorithmPairs;
@@ -454,17 +1514,19 @@ std::vector<Future> simulateFutures(
         }
     }
 
-    // DirectionSet firstMoves = safeMoves(initialState);
-    //
-    // if (firstMoves.empty())
-    // {
-    //     firstMoves = riskyMoves(initialState);
-    // }
-
-    std::vector<Future> futures = runSimulations(
-        algorithmPairs, initialState, maxTurns, maxMillis);
+    return runSimulationsAsync(
+        algorithmPairs, initialState, maxTurns, deadline, horizon);
+}
 
-    return futures;
+std::vector<Future> simulateFutures(
+    GameState &initialState,
+    uint32_t maxTurns,
+    Deadline deadline,
+    std::vector<PrefixedAlgorithm> myAlgorithms,
+    std::vector<PrefixedAlgorithm> enemyAlgorithms)
+{
+    return simulateFuturesAsync(
+        initialState, maxTurns, deadline, myAlgorithms, enemyAlgorithms).get();
 }
 
 int getFoodScore(uint32_t foodTurn, GameState &state)
@@ -481,9 +1543,14 @@ int getFoodScore(uint32_t foodTurn, GameState &state)
     return inverseDiff * multiplier;
 }
 
-int scoreFuture(Future &future, GameState &state, MaybeDirection preferred)
+int scoreFuture(
+    Future &future,
+    GameState &state,
+    const FeatureTable &features,
+    MaybeDirection preferred)
 {
-    auto myId = state.mySnake()->id;
+    const MoveFeatures &move = features.at(future.move);
+    uint32_t mySlot = state.mySnake()->slot;
     uint32_t survivalScore = 1000000000;
     uint32_t murderScore = 0;
     uint32_t foodScore = 0;
@@ -493,16 +1560,11 @@ int scoreFuture(Future &future, GameState &state, MaybeDirection preferred)
     uint32_t bonus = isPreferredDirection ? 500 : 0;
     uint32_t nextFood = 1000; // a big number that indicates starvation
 
-    auto foodIt = future.foodsEaten.find(state.mySnake()->id);
-    if (foodIt != future.foodsEaten.end())
+    if (mySlot < MAX_SNAKES && future.firstFoodTurn[mySlot] != NEVER)
     {
-        std::vector<uint32_t> &foodTurns = foodIt->second;
-        if (!foodTurns.empty())
-        {
-            nextFood = foodTurns.at(0);
-            foodScore = getFoodScore(foodTurns.at(0), state);
-            //foodScore += 100U - (std::min(100U, foodTurns.at(0)));
-        }
+        nextFood = future.firstFoodTurn[mySlot];
+        foodScore = getFoodScore(nextFood, state);
+        //foodScore += 100U - (std::min(100U, nextFood));
     }
 
     if (nextFood > state.mySnake()->health)
@@ -511,50 +1573,36 @@ int scoreFuture(Future &future, GameState &state, MaybeDirection preferred)
         dies = true;
     }
 
-    for (auto pair : future.obituaries)
+    for (uint32_t slot = 0; slot < MAX_SNAKES; slot++)
     {
-        if (pair.first == myId)
+        uint32_t deathTurn = future.deathTurn[slot];
+        if (deathTurn == NEVER)
+            continue;
+
+        if (slot == mySlot)
         {
-            survivalScore = std::min(survivalScore, pair.second * 100);
+            survivalScore = std::min(survivalScore, deathTurn * 100);
             dies = true;
         }
         else
         {
-            murderScore += (100U - (std::min(100U, pair.second))) * 10000;
+            murderScore += (100U - (std::min(100U, deathTurn))) * 10000;
         }
     }
 
     if (!dies)
     {
-        uint32_t accessible = 0;
-
-        if(future.move == Direction::Up)
-        {
-            accessible = state.getSpacesUp();
-        } 
-        else if(future.move == Direction::Down)
-        {
-            accessible = state.getSpacesDown();
-        } 
-        else if(future.move == Direction::Left)
-        {
-            accessible = state.getSpacesLeft();
-        } 
-        else 
-        {
-            accessible = state.getSpacesRight();
-        }
+        uint32_t accessible = move.accessible;
         if (accessible < state.mySnake()->length())
         {
-            std::cout << "TOO SMALL " << accessible << " | " << state.mySnake()->length()
-                << " | " << directionToString(future.move) << "\n";
+            LOG(LogLevel::Debug) << "TOO SMALL " << accessible << " | "
+                << state.mySnake()->length() << " | " << directionToString(future.move);
             survivalScore = std::min(survivalScore, accessible * 100U);
             dies = true;
         }
     }
 
-    bool badCorner = couldEndUpCornerAdjacentToBiggerSnake(state, future.move);
-    if (badCorner)
+    if (move.cornerDanger)
     {
         survivalScore = std::min(survivalScore, 1000U); // ???
         dies = true;
@@ -573,7 +1621,8 @@ int scoreFuture(Future &future, GameState &state, MaybeDirection preferred)
 
     uint32_t finalScore = dies
         ? survivalScore + bonus
-        : survivalScore + foodScore + murderScore + bonus;
+        : survivalScore + foodScore + murderScore + bonus + future.evaluation
+            + future.leafScore;
 
     // std::cout << "survive: " << survivalScore
     //     << " murder: " << murderScore
@@ -603,33 +1652,84 @@ int scoreFuture(Future &future, GameState &state, MaybeDirection preferred)
     // return score;
 }
 
-std::string directionScoreToString(DirectionScore ds)
+std::string directionScoreToString(
+    DirectionScore ds, const BranchTable &branches)
 {
     std::stringstream ss;
-    ss << directionToString(ds.direction)
-        << ", " << ds.score
-        << ", " << ds.source->source.pair.myAlgorithm->meta().name;
+    ss << directionToString(ds.direction) << ", " << ds.score;
+    if (ds.source)
+    {
+        ss << ", " << branches.at(ds.source->branch).pair.myAlgorithm->meta().name;
+    }
     return ss.str();
 }
 
-std::string getKey(Future &f)
+// Futures from branches where I play the same algorithm with the same prefix
+// (and so start with the same move) are one option for me.
+bool sameGroup(const AlgorithmBranch &a, const AlgorithmBranch &b)
 {
-    std::stringstream ss;
-    ss << f.source.pair.myAlgorithm->meta().name
-        << ":" << prefixToString(f.source.firstMoves);
-    return ss.str();
+    return &a == &b
+        || (a.pair.myAlgorithm == b.pair.myAlgorithm && a.firstMoves == b.firstMoves);
+}
+
+// Futures from branches where the enemies play the same algorithm the same
+// way are one option for them.
+bool sameResponse(const AlgorithmBranch &a, const AlgorithmBranch &b)
+{
+    return &a == &b
+        || (a.pair.enemyAlgorithm == b.pair.enemyAlgorithm
+            && a.enemyPathBindingBias == b.enemyPathBindingBias);
+}
+
+// Future scores only really mean something in order: the first thing they
+// measure is how long I survive, so surviving a few more turns is worth a lot
+// when I'm about to die and next to nothing once I'm safe. The game needs
+// payoffs that can be averaged, so squash them into 0..1 that way.
+double futureUtility(int score)
+{
+    return 1.0 - std::exp(-std::max(score, 0) / BEST_MOVE_UTILITY_SCALE);
 }
 
+// One of my options: a group of branches and the first move they made (an
+// algorithm without a prefix can start differently against different
+// enemies). Keeps the worst and best futures for the decision log.
+struct MyOption
+{
+    const AlgorithmBranch *branch;
+    Direction move;
+    DirectionScore worst;
+    DirectionScore best;
+};
+
 Direction bestMove(
-    std::vector<Future> &futures, GameState &state, MaybeDirection preferred)
+    std::vector<Future> &futures,
+    const BranchTable &branches,
+    GameState &state,
+    MaybeDirection preferred)
 {
-    // 1. Get worst score per first-algorithm, direction pair and store as
-    //    score, direction pair (where direction is NOT unique).
-    // 2. Take the pair with the best score and return its direction.
+    return bestMove(futures, branches, state, FeatureTable(state), preferred);
+}
 
-    // TODO: this key should be a struct with its own hash function, not string
-    std::unordered_map<std::string, DirectionScore> worstScores;
-    std::unordered_map<std::string, DirectionScore> bestScores;
+Direction bestMove(
+    std::vector<Future> &futures,
+    const BranchTable &branches,
+    GameState &state,
+    const FeatureTable &features,
+    MaybeDirection preferred)
+{
+    // Everybody moves at the same time, so this is a game where I pick one of
+    // my options (rows) while the enemies pick one of theirs (columns), and
+    // each future's score is what I get for that pair. Solving it for the
+    // mixed equilibrium picks the option that does best against the enemy
+    // mix that hurts me most, rather than judging each option by its single
+    // worst future.
+    //
+    // There are only ever a handful of options on each side so they live in
+    // fixed arrays and get found by a linear search.
+    std::array<MyOption, MATRIX_GAME_MAX_ROWS> options;
+    std::array<const AlgorithmBranch *, MATRIX_GAME_MAX_COLS> responses;
+    std::array<std::array<bool, MATRIX_GAME_MAX_COLS>, MATRIX_GAME_MAX_ROWS> seen {};
+    MatrixGame game;
 
     for (Future &future : futures)
     {
@@ -640,80 +1740,121 @@ Direction bestMove(
             continue;
 
         Direction direction = future.move;
-        int score = scoreFuture(future, state, preferred);
+        int score = scoreFuture(future, state, features, preferred);
+        DirectionScore scored { direction, score, &future };
 
-        std::string key = getKey(future);
-
-        //std::cout << "  " << key << "=" << score << std::endl;
+        const AlgorithmBranch &branch = branches.at(future.branch);
+        size_t r = 0;
+        while (r < game.rows
+            && !(options[r].move == direction && sameGroup(*options[r].branch, branch)))
+        {
+            r++;
+        }
 
-        auto it = worstScores.find(key);
-        if (it == worstScores.end())
+        size_t c = 0;
+        while (c < game.cols && !sameResponse(*responses[c], branch))
         {
-            worstScores[key] = { direction, score, &future };
+            c++;
         }
-        else
+
+        if ((r == game.rows && r == options.size())
+            || (c == game.cols && c == responses.size()))
         {
-            DirectionScore existing = it->second;
-            if (score < existing.score)
-            {
-                worstScores[key] = { direction, score, &future };
-            }
+            LOG(LogLevel::Warning) << "Too many options in bestMove, ignoring "
+                << branch.pair.myAlgorithm->meta().name;
+            continue;
         }
 
-        it = bestScores.find(key);
-        if (it == bestScores.end())
+        if (r == game.rows)
         {
-            bestScores[key] = { direction, score, &future };
+            options[game.rows++] = { &branch, direction, scored, scored };
         }
-        else
+        if (c == game.cols)
         {
-            DirectionScore existing = it->second;
-            if (score > existing.score)
-            {
-                bestScores[key] = { direction, score, &future };
-            }
+            responses[game.cols++] = &branch;
         }
-    }
-
-    DirectionScore bestOfTheWorst{ Direction::Up, -1, nullptr };
-    DirectionScore bestOfTheBest{ Direction::Up, -1, nullptr };
-    DirectionScore result{ Direction::Up, -1, nullptr };
 
-    for (auto it : worstScores)
-    {
-        if (bestOfTheWorst.score < 0)
+        MyOption &option = options[r];
+        if (score < option.worst.score)
         {
-            bestOfTheWorst = it.second;
+            option.worst = scored;
         }
-        else if (it.second.score > bestOfTheWorst.score)
+        if (score > option.best.score)
         {
-            bestOfTheWorst = it.second;
+            option.best = scored;
         }
-    }
 
-    for (auto it : bestScores)
-    {
-        if (bestOfTheBest.score < 0)
+        // If the same pair comes up more than once then go by the worst.
+        double utility = futureUtility(score);
+        if (!seen[r][c] || utility < game.payoff[r][c])
         {
-            bestOfTheBest = it.second;
+            game.payoff[r][c] = utility;
+            seen[r][c] = true;
         }
-        else if (it.second.score > bestOfTheBest.score)
+    }
+
+    if (game.rows == 0)
+    {
+        LOG(LogLevel::Info) << "Decision: no futures";
+        return Direction::Up;
+    }
+
+    // Pairs that never got simulated (eg: the algorithm went another way
+    // against those enemies) count as the worst that's known about the
+    // option.
+    for (size_t r = 0; r < game.rows; r++)
+    {
+        for (size_t c = 0; c < game.cols; c++)
         {
-            bestOfTheBest = it.second;
+            if (!seen[r][c])
+            {
+                game.payoff[r][c] = futureUtility(options[r].worst.score);
+            }
         }
     }
 
-    if (bestOfTheWorst.score < 1500)
+    game.solve(BEST_MOVE_SOLVER_ITERATIONS);
+
+    // An actual move has to be made, so go with my best option against the
+    // enemies' equilibrium mix. Every option the equilibrium would mix for me
+    // does equally well against it. Options within a hair of each other are
+    // split by their worst case, which is all that counts when every option
+    // survives. Going by the enemies' side also means it doesn't matter how
+    // many of my options start with the same move.
+    //
+    // If even the equilibrium looks fatal then the enemies would have to play
+    // perfectly to get me and they don't, so bet on the best case instead.
+    bool desperate = game.value < futureUtility(BEST_MOVE_DESPERATE_SCORE);
+    if (desperate)
     {
-        std::cout << "TAKING MY CHANCES!!!\n";
-        result = bestOfTheBest;
+        LOG(LogLevel::Info) << "TAKING MY CHANCES!!!";
     }
-    else
+
+    size_t chosen = 0;
+    for (size_t r = 1; r < game.rows && desperate; r++)
     {
-        result = bestOfTheWorst;
+        if (options[r].best.score > options[chosen].best.score)
+        {
+            chosen = r;
+        }
+    }
+
+    for (size_t r = 1; r < game.rows && !desperate; r++)
+    {
+        double diff = game.rowValue(r) - game.rowValue(chosen);
+        bool tied = std::abs(diff) <= BEST_MOVE_VALUE_EPSILON;
+        if ((!tied && diff > 0.0)
+            || (tied && options[r].worst.score > options[chosen].worst.score))
+        {
+            chosen = r;
+        }
     }
 
-    std::cout << "Decision: " << directionScoreToString(result) << std::endl;
+    MyOption &result = options[chosen];
+    LOG(LogLevel::Info) << "Decision: "
+        << directionScoreToString(desperate ? result.best : result.worst, branches)
+        << " | expected " << game.rowValue(chosen)
+        << " | best " << result.best.score;
 
-    return result.direction;
+    return result.move;
 }
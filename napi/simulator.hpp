@@ -2,21 +2,70 @@
 
 #include "snakelib.hpp"
 #include "timing.hpp"
+#include "rollout.hpp"
+#include "policy.hpp"
+#include "features.hpp"
 #include <thread>
 #include <chrono>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <array>
 
-// Sleep this amount of time each iteration of worker thread when in sleep mode.
-#define SLEEP_MODE_DELAY_MILLIS 10
+// Turn number in a Future for something that didn't happen.
+#define NEVER UINT16_MAX
 
-// Amount of time with no work before worker thread enters sleep mode.
-#define SECONDS_OF_NO_WORK_UNTIL_SLEEP 10.0
+// How many turns simulations play with their real algorithms before handing
+// over to cheapRolloutMove(). Far enough out the details stop mattering much
+// and the full algorithms cost far more than they're worth.
+#define ROLLOUT_EXPENSIVE_TURNS 12
+
+// For branches that should use their real algorithms the whole way.
+#define NO_CHEAP_TIER UINT32_MAX
 
 enum class TerminationReason
 {
-    Loss, MaxTurns, OutOfTime, Unknown
+    Loss, MaxTurns, OutOfTime, Pruned, Unknown
+};
+
+#define TERMINATION_REASONS 5
+
+// One in this many simulated turns gets timed. Reading the clock costs about
+// as much as a cheap rollout turn so doing it every turn would skew things.
+#define METRICS_SAMPLE_INTERVAL 8
+
+// What the simulations for one move got done. Each SimThread fills in its own
+// (so there's no locking while simulating) and they're added up when the
+// batch is collected.
+struct SimulatorMetrics
+{
+    uint32_t threads = 0;
+    uint32_t branches = 0;
+    uint64_t turns = 0;
+
+    // Wall time spent simulating, summed over threads.
+    double seconds = 0.0;
+
+    // Where the time went in the sampled turns (see METRICS_SAMPLE_INTERVAL):
+    // choosing moves, applying them and building the new states.
+    double policySeconds = 0.0;
+    double rulesSeconds = 0.0;
+    double stateSeconds = 0.0;
+
+    // Indexed by TerminationReason.
+    std::array<uint32_t, TERMINATION_REASONS> terminations {};
+
+    void add(const SimulatorMetrics &other);
+    double turnsPerSecondPerThread() const;
+    void prettyPrint() const;
 };
 
+// The metrics for the most recent move, for anyone who wants to report them.
+void publishSimulatorMetrics(const SimulatorMetrics &metrics);
+SimulatorMetrics latestSimulatorMetrics();
+
 struct AlgorithmPair
 {
     Algorithm *myAlgorithm;
@@ -28,6 +77,7 @@ struct AlgorithmBranch
     AlgorithmPair pair;
     std::vector<Direction> firstMoves;
     AxisBias enemyPathBindingBias;
+    uint32_t expensiveTurns = ROLLOUT_EXPENSIVE_TURNS;
 };
 
 struct PrefixedAlgorithm
@@ -44,16 +94,32 @@ struct PrefixedAlgorithmPair
     AlgorithmPair unprefixed();
 };
 
+// Every branch handed out in one go. Futures refer to their branch by index
+// so the table must not change until they've been scored.
+typedef std::vector<AlgorithmBranch> BranchTable;
+
+// Outcome of one simulated branch. Kept small and fixed size so that copying
+// results between threads is cheap. Per snake values are indexed by the
+// snake's slot and are NEVER if it didn't happen.
 struct Future
 {
-    std::unordered_map<std::string, uint32_t> obituaries;
-    std::unordered_map<std::string, std::vector<uint32_t>> foodsEaten;
+    std::array<uint16_t, MAX_SNAKES> deathTurn;
+    std::array<uint16_t, MAX_SNAKES> firstFoodTurn;
     TerminationReason terminationReason;
     Direction move;
     uint32_t turns;
-    AlgorithmBranch source;
+    uint32_t branch;
+
+    // Up to EVALUATOR_SCORE_WEIGHT for how good the last state looked to the
+    // evaluator. Zero if I lost or no weights are loaded.
+    uint16_t evaluation;
 
-    void prettyPrint();
+    // How good the last state looked (see leafScore) if the simulation got
+    // cut off at maxTurns, or with a horizon (see runSimulationsAsync) if it
+    // got cut off any other way short of losing. Otherwise zero.
+    int32_t leafScore;
+
+    void prettyPrint(const BranchTable &branches);
 };
 
 std::string terminationReasonToString(TerminationReason reason);
@@ -69,40 +135,69 @@ class Simulation
 {
 public:
     Simulation(
-        AlgorithmBranch branch,
+        const AlgorithmBranch &branch,
         uint32_t branchId,
         GameState &initialState,
         uint32_t maxTurns,
-        uint32_t maxMillis,
         uint32_t simNumber,
-        AxisBias bias);
+        AxisBias bias,
+        SimulatorMetrics *metrics);
 
     bool next();
     Future result() { return _result; }
     uint32_t simNumber() { return _simNumber; }
+    uint32_t turn() { return _turn; }
+    const AlgorithmBranch &branch() { return _branch; }
+    GameState &state() { return _newestState ? *_newestState : _initialState; }
+
+    // Hash of every state this simulation has been through so far.
+    uint64_t history() { return _history; }
+
+    // Where next() adds its timings. Changes whenever a different thread
+    // picks the simulation up.
+    void setMetrics(SimulatorMetrics *metrics) { _metrics = metrics; }
 
 private:
-    Direction getMyMove(GameState &state, uint32_t branchId)
+    Direction getMyMove(GameState &state)
     {
         if (_turn <= _branch.firstMoves.size())
         {
             return _branch.firstMoves.at(_turn - 1);
         }
+        else if (isCheapTurn())
+        {
+            return cheapRolloutMove(state, state.mySnake(), _foodField);
+        }
         else
         {
-            return _branch.pair.myAlgorithm->move(state, branchId);
+            return policyMove(
+                _myPolicy,
+                _branch.pair.myAlgorithm,
+                state,
+                policyState(state.mySnake()));
         }
     }
 
+    bool isCheapTurn()
+    {
+        return _turn > _branch.expensiveTurns;
+    }
+
+    // Slots past MAX_SNAKES (only in huge games) end up sharing.
+    PolicyState &policyState(Snake *snake)
+    {
+        return _policyStates[snake->slot % MAX_SNAKES];
+    }
+
     void updateObituaries(GameState &newState, GameState &oldState)
     {
         for (auto pair : oldState.snakes())
         {
             Snake *snake = pair.second;
             auto newIter = newState.snakes().find(snake->id);
-            if (newIter == newState.snakes().end())
+            if (newIter == newState.snakes().end() && snake->slot < MAX_SNAKES)
             {
-                _result.obituaries[snake->id] = _turn;
+                _result.deathTurn[snake->slot] = _turn;
             }
         }
     }
@@ -112,88 +207,224 @@ private:
         for (Point food : oldState.food())
         {
             Snake *inThatCellNow = newState.map().getSnake(food);
-            if (inThatCellNow != nullptr)
+            if (inThatCellNow != nullptr
+                && inThatCellNow->slot < MAX_SNAKES
+                && _result.firstFoodTurn[inThatCellNow->slot] == NEVER)
             {
-                auto iter = _result.foodsEaten.find(inThatCellNow->id);
-                if (iter == _result.foodsEaten.end())
-                {
-                    _result.foodsEaten[inThatCellNow->id] = {};
-                }
-                _result.foodsEaten[inThatCellNow->id].push_back(_turn);
+                _result.firstFoodTurn[inThatCellNow->slot] = _turn;
             }
         }
     }
 
-    AlgorithmBranch _branch;
+    const AlgorithmBranch &_branch;
     uint32_t _branchId;
     GameState &_initialState;
     uint32_t _maxTurns;
-    uint32_t _maxMillis;
     uint32_t _simNumber;
     AxisBias _enemyPathfindingBias;
+
+    // Looked up once so that built in policies can be run directly.
+    PolicyKind _myPolicy;
+    PolicyKind _enemyPolicy;
+
     uint32_t _turn;
+    uint64_t _history;
+    SimulatorMetrics *_metrics;
     Future _result;
+    std::array<PolicyState, MAX_SNAKES> _policyStates;
+    FoodDistanceField _foodField;
     std::unique_ptr<GameState> _newestState;
 };
 
+// Simulates the given rows of the table. Each future's branch is its row.
+std::vector<Future> runSimulationBranches(
+    const BranchTable &branches,
+    const std::vector<uint32_t> &ids,
+    GameState &initialState,
+    uint32_t maxTurns,
+    Deadline deadline,
+    std::atomic<bool> *cancelled = nullptr,
+    SimulatorMetrics *metrics = nullptr);
+
+// Simulates every row of the table.
 std::vector<Future> runSimulationBranches(
-    std::vector<AlgorithmBranch> &branches,
+    const BranchTable &branches,
     GameState &initialState,
     uint32_t maxTurns,
-    uint32_t maxMillis);
+    Deadline deadline,
+    std::atomic<bool> *cancelled = nullptr);
+
+struct SimulationBatch;
+
+// Refers to a set of simulations that were handed to the SimThread pool. The
+// caller is free to do other work and then poll, wait with a deadline or
+// block for the futures. If the handle goes away before the simulations are
+// done they are cancelled and waited on so that no thread is left using
+// algorithms or state owned by the caller.
+class SimulationHandle
+{
+public:
+    SimulationHandle();
+    SimulationHandle(std::shared_ptr<SimulationBatch> batch);
+    SimulationHandle(const SimulationHandle &) = delete;
+    SimulationHandle(SimulationHandle &&) = default;
+    SimulationHandle &operator=(SimulationHandle &&);
+    ~SimulationHandle();
+
+    bool ready();
+    bool waitUntil(Clock::time_point deadline);
+
+    // Background work (eg: pondering) that should be cancelled rather than
+    // waited for if anything else needs the threads.
+    void makePreemptible();
+
+    void cancel();
+    std::vector<Future> get();
+
+    // What the futures' branch ids refer to. Stays valid as long as the
+    // handle does.
+    const BranchTable &branches();
+
+    // Waits for the simulations like get() does.
+    SimulatorMetrics metrics();
+
+private:
+    std::shared_ptr<SimulationBatch> _batch;
+};
+
+// With a horizon, maxTurns is where the simulations are meant to stop, so
+// ones that get stopped any earlier than that (by the deadline or pruning)
+// get a leaf score too. Otherwise only ones that reach maxTurns do.
+SimulationHandle runSimulationsAsync(
+    std::vector<PrefixedAlgorithmPair> algorithmPairs,
+    GameState &initialState,
+    uint32_t maxTurns,
+    Deadline deadline,
+    bool horizon = false);
 
 std::vector<Future> runSimulations(
     std::vector<PrefixedAlgorithmPair> algorithmPairs,
     GameState &initialState,
     uint32_t maxTurns,
-    uint32_t maxMillis);
+    Deadline deadline);
+
+SimulationHandle simulateFuturesAsync(
+    GameState &initialState,
+    uint32_t maxTurns,
+    Deadline deadline,
+    std::vector<PrefixedAlgorithm> myAlgorithms,
+    std::vector<PrefixedAlgorithm> enemyAlgorithms,
+    bool horizon = false);
 
 std::vector<Future> simulateFutures(
     GameState &initialState,
     uint32_t maxTurns,
-    uint32_t maxMillis,
+    Deadline deadline,
     std::vector<PrefixedAlgorithm> myAlgorithms,
     std::vector<PrefixedAlgorithm> enemyAlgorithms);
 
+// Runs the same job once on every SimThread for anything that wants to use
+// the pool other than the normal branch simulations (eg: tree search). The
+// job gets the index of the thread running it and the batch's cancel flag.
+// The handle's get() returns no futures.
+typedef std::function<void(uint32_t, std::atomic<bool> &)> SimThreadJob;
+
+SimulationHandle runOnSimThreadsAsync(SimThreadJob job);
+
+// The features can be worked out while the simulations run, otherwise the
+// second version does it.
+Direction bestMove(
+    std::vector<Future> &futures,
+    const BranchTable &branches,
+    GameState &state,
+    const FeatureTable &features,
+    MaybeDirection preferred = MaybeDirection::none());
+
 Direction bestMove(
     std::vector<Future> &futures,
+    const BranchTable &branches,
     GameState &state,
     MaybeDirection preferred = MaybeDirection::none());
 
 std::string fakeGameId();
 
+class BranchSearch;
+
+// Every SimThread gets the same search and its own copy of the state.
 struct SimParams
 {
-    std::vector<AlgorithmBranch> branches;
+    std::shared_ptr<const BranchTable> branches;
+    std::shared_ptr<BranchSearch> search;
     std::unique_ptr<GameState> state;
-    uint32_t maxTurns;
-    uint32_t maxMillis;
+    Deadline deadline;
+    std::atomic<bool> *cancelled;
+};
+
+// Counts down once per outstanding job so that whoever handed out the work
+// can block until all of it is finished instead of polling every thread.
+class Latch
+{
+public:
+    Latch(uint32_t count);
+
+    // delete move and copy ctors since threads hold a pointer to the latch
+    Latch(const Latch &) = delete;
+    Latch(Latch &&) = delete;
+
+    void countDown();
+    void wait();
+    bool waitUntil(Clock::time_point deadline);
+    bool done();
+
+private:
+    std::atomic<uint32_t> _count;
+    std::mutex _mutex;
+    std::condition_variable _allDone;
+};
+
+struct SimThreadOptions
+{
+    // How many threads to start. 0 means one per core, less the one left for
+    // I/O when pinning.
+    unsigned threads;
+
+    // Pin each thread to its own core and keep them all off the first one so
+    // that whoever is answering requests never waits behind a simulation.
+    bool pin;
 };
 
 class SimThread
 {
 public:
     SimThread();
-    void startWork(SimParams params);
+    void startWork(SimParams params, Latch *latch);
+    void startJob(std::function<void()> job, Latch *latch);
     void spin();
     std::vector<Future> &result();
+    SimulatorMetrics &metrics();
     bool done();
     void kill();
     void join();
-    void wakeUp();
-    void sleep();
 
     static std::vector<std::unique_ptr<SimThread>> instances;
+    static SimThreadOptions options;
     static void startAll();
     static void stopAll();
-    static void wakeAll();
 
 private:
+    bool pinTo(unsigned core);
+
     std::vector<Future> _result;
+    SimulatorMetrics _metrics;
     SimParams _params;
-    volatile bool _hasWork;
-    volatile bool _quit;
+    std::function<void()> _job;
+    Latch *_latch;
+    std::atomic<bool> _hasWork;
+    std::atomic<bool> _quit;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+
+    // Keep this last so that everything spin() touches is initialized before
+    // the thread starts.
     std::thread _thread;
-    Clock::time_point _timeOfLastWork;
-    volatile bool _sleeping;
 };
@@ -1,6 +1,61 @@
 #include "snakelib.hpp"
+#include "zobrist.hpp"
+#include "patterns.hpp"
 #include <queue>
 
+// Most freed states (and cell buffers) each thread keeps around for reuse.
+#define STATE_POOL_MAX 256
+
+// Every simulated turn makes a new GameState (with a Map full of cells) and
+// throws the last one away. Each thread keeps the memory from recent ones to
+// reuse instead of going back to the shared allocator every time. Memory
+// freed on a different thread than it came from just joins that thread's
+// pool.
+struct StatePool
+{
+    ~StatePool()
+    {
+        for (void *block : states)
+        {
+            ::operator delete(block);
+        }
+        destroyed = true;
+    }
+
+    std::vector<void *> states;
+    std::vector<std::vector<Cell>> cells;
+
+    static thread_local StatePool instance;
+
+    // States can outlive the pool (eg: ones held by statics on the main
+    // thread) so after this is set they go straight back to the allocator.
+    static thread_local bool destroyed;
+};
+
+thread_local StatePool StatePool::instance;
+thread_local bool StatePool::destroyed = false;
+
+std::vector<Cell> takeCells(size_t count)
+{
+    std::vector<Cell> cells;
+    if (!StatePool::destroyed && !StatePool::instance.cells.empty())
+    {
+        cells = std::move(StatePool::instance.cells.back());
+        StatePool::instance.cells.pop_back();
+        cells.clear();
+    }
+    cells.resize(count);
+    return cells;
+}
+
+void giveCells(std::vector<Cell> &cells)
+{
+    if (!StatePool::destroyed && StatePool::instance.cells.size() < STATE_POOL_MAX)
+    {
+        StatePool::instance.cells.push_back(std::move(cells));
+    }
+}
+
 void Point::prettyPrint()
 {
     std::cout << x << "," << y;
@@ -66,7 +121,12 @@ uint32_t Algorithm::nextId()
     return _nextId++;
 }
 
-Direction Algorithm::move(GameState &state, uint32_t /*branchId*/)
+Direction Algorithm::move(GameState &state, PolicyState &/*policyState*/)
+{
+    return move(state);
+}
+
+Direction Algorithm::move(GameState &state, const Deadline &/*deadline*/)
 {
     return move(state);
 }
@@ -78,8 +138,39 @@ GameState::GameState(World w, AxisBias bias) :
     _mySnake(nullptr),
     _world(w),
     _map(*this),
-    _pathfindingBias(bias)
+    _pathfindingBias(bias),
+    _hasHeadMaps(false)
 {
+    // Snakes keep their slot from one state to the next. New ones get the
+    // lowest slot nobody else is using.
+    uint64_t usedSlots = 0;
+    for (Snake &snake : _world.snakes)
+    {
+        if (snake.slot != NO_SLOT)
+        {
+            usedSlots |= 1ULL << (snake.slot % 64);
+        }
+    }
+    for (Snake &snake : _world.snakes)
+    {
+        if (snake.slot == NO_SLOT)
+        {
+            uint32_t slot = 0;
+            while (usedSlots & (1ULL << (slot % 64)) && slot < 64)
+            {
+                slot++;
+            }
+            snake.slot = slot;
+            usedSlots |= 1ULL << (slot % 64);
+        }
+    }
+
+    if (!_world.hasHash)
+    {
+        _world.hash = zobristWorld(_world);
+        _world.hasHash = true;
+    }
+
     for (size_t i = 0; i < _world.snakes.size(); i++)
     {
         Snake *snake = &_world.snakes[i];
@@ -97,6 +188,31 @@ GameState::GameState(World w, AxisBias bias) :
     _map.update();
 }
 
+void *GameState::operator new(size_t size)
+{
+    StatePool &pool = StatePool::instance;
+    if (!StatePool::destroyed && size == sizeof(GameState) && !pool.states.empty())
+    {
+        void *block = pool.states.back();
+        pool.states.pop_back();
+        return block;
+    }
+    return ::operator new(size);
+}
+
+void GameState::operator delete(void *block, size_t size)
+{
+    StatePool &pool = StatePool::instance;
+    if (!StatePool::destroyed
+        && size == sizeof(GameState)
+        && pool.states.size() < STATE_POOL_MAX)
+    {
+        pool.states.push_back(block);
+        return;
+    }
+    ::operator delete(block);
+}
+
 GameState &GameState::perspective(Snake *enemy, AxisBias bias)
 {
     auto iter = _perspectiveCopies.find(enemy->id);
@@ -107,12 +223,46 @@ GameState &GameState::perspective(Snake *enemy, AxisBias bias)
 
     World newWorld = _world;
     newWorld.you = enemy->id;
+    if (_mySnake != nullptr)
+    {
+        newWorld.hash ^= zobristYou(_mySnake->slot);
+    }
+    newWorld.hash ^= zobristYou(enemy->slot);
     _perspectiveCopies.insert(
         std::make_pair(enemy->id,
             std::unique_ptr<GameState>(new GameState(newWorld, bias))));
     return *_perspectiveCopies[enemy->id];
 }
 
+void GameState::buildHeadMaps()
+{
+    size_t words = (_width * _height + 63) / 64;
+    _biggerHeads.assign(words, 0);
+    _smallerHeads.assign(words, 0);
+    _hasHeadMaps = true;
+
+    if (_mySnake == nullptr)
+        return;
+
+    for (Snake *enemy : _enemies)
+    {
+        std::vector<uint64_t> &bits = _mySnake->length() <= enemy->length()
+            ? _biggerHeads
+            : _smallerHeads;
+
+        Point head = enemy->head();
+        for (Direction dir : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+        {
+            Point p = coordAfterMove(head, dir);
+            if (!outOfBounds(p, *this))
+            {
+                uint32_t index = cellIndex(p, *this);
+                bits[index / 64] |= 1ULL << (index % 64);
+            }
+        }
+    }
+}
+
 std::unique_ptr<GameState> GameState::newStateAfterMoves(
     std::vector<SnakeMove> &moves)
 {
@@ -175,11 +325,16 @@ void Cell::resetVacate()
 
 Map::Map(GameState &gameState) :
     _gameState(gameState),
-    _cells(gameState.width() * gameState.height())
+    _cells(takeCells(gameState.width() * gameState.height()))
 {
     update();
 }
 
+Map::~Map()
+{
+    giveCells(_cells);
+}
+
 uint32_t Map::turnsUntilVacant(Point p)
 {
     return outOfBounds(p, _gameState)
@@ -268,6 +423,14 @@ void moveHeadsForward(World &world, std::vector<SnakeMove> &moves)
 
         Direction direction = (*iter).direction;
         Point destination = coordAfterMove(snake.head(), direction);
+        if (world.hasHash)
+        {
+            // Old head becomes part of the body.
+            uint32_t oldHead = cellIndex(snake.head(), world.width);
+            world.hash ^= zobristHead(snake.slot, oldHead)
+                ^ zobristBody(snake.slot, oldHead)
+                ^ zobristHead(snake.slot, cellIndex(destination, world.width));
+        }
         snake.parts.insert(snake.parts.begin(), destination);
     }
 }
@@ -323,7 +486,15 @@ void eatFoodOrDie(World &world)
         if (justAteIter == justAte.end())
         {
             // It didn't eat so remove end of tail.
+            Point oldTail = snake.tail();
             snake.parts.pop_back();
+            if (world.hasHash)
+            {
+                uint32_t oldTailCell = cellIndex(oldTail, world.width);
+                world.hash ^= zobristBody(snake.slot, oldTailCell)
+                    ^ zobristTail(snake.slot, oldTailCell)
+                    ^ zobristTail(snake.slot, cellIndex(snake.tail(), world.width));
+            }
         }
         else
         {
@@ -336,11 +507,31 @@ void eatFoodOrDie(World &world)
             {
                 size_t oldTailIndex = snake.parts.size() - 1;
                 size_t newTailIndex = snake.parts.size() - 2;
+                if (world.hasHash)
+                {
+                    uint32_t oldTailCell = cellIndex(snake.parts[oldTailIndex], world.width);
+                    uint32_t newTailCell = cellIndex(snake.parts[newTailIndex], world.width);
+                    world.hash ^= zobristBody(snake.slot, oldTailCell)
+                        ^ zobristTail(snake.slot, oldTailCell)
+                        ^ zobristBody(snake.slot, newTailCell)
+                        ^ zobristTail(snake.slot, newTailCell);
+                }
                 snake.parts[oldTailIndex] = snake.parts.at(newTailIndex);
             }
 
             //snake.parts.pop_back();
             // It did eat so remove the food it ate.
+            if (world.hasHash)
+            {
+                uint32_t foodCell = cellIndex(snake.head(), world.width);
+                for (Point food : world.food)
+                {
+                    if (food == snake.head())
+                    {
+                        world.hash ^= zobristFood(foodCell);
+                    }
+                }
+            }
             world.food.erase(
                 std::remove(
                     world.food.begin(),
@@ -416,6 +607,17 @@ void markCrashersDead(World &world)
 
 void removeDeadGuys(World &world)
 {
+    if (world.hasHash)
+    {
+        for (Snake &snake : world.snakes)
+        {
+            if (snake.dead)
+            {
+                world.hash ^= zobristSnake(world, snake);
+            }
+        }
+    }
+
     world.snakes.erase(
         std::remove_if(world.snakes.begin(), world.snakes.end(),
             [](const Snake &s) { return s.dead; }),
@@ -499,149 +701,8 @@ uint32_t countAccessibleCellsAfterMove(
     return countAccessibleCells(state, p);
 }
 
-/*
-Numbers represent all the positions that are in the danger zone.
-ie: they could move into a corner-adjacent position to the '+'
-snake which is super dangerous. s, t, u, v, w, x, y, z are the
-destination points that we do not want the enemy snake to move to.
-_ _ _ _ _ _ _ _ _
-_ _ _ 3 _ 4 _ _ _
-_ _ 2 t _ u 5 _ _
-_ 1 s _ _ _ v 6 _
-_ _ _ _ + _ _ _ _
-_ c z _ _ _ w 7 _
-_ _ b y _ x 8 _ _
-_ _ _ a _ 9 _ _ _
-_ _ _ _ _ _ _ _ _
-*/
-
-bool isTooBigForMeToEat(GameState &state, Snake *snake)
-{
-    uint32_t myLength = state.mySnake()->length();
-    uint32_t theirLength = snake->length();
-    return myLength <= theirLength;
-}
-
-bool spaceIsOpen(GameState &state, Point destination)
-{
-    return !outOfBounds(destination, state) && state.map().turnsUntilVacant(destination) == 0;
-}
-
-// bool isInDangerZone(GameState &state, std::array<Point, 6> &dangerPoints, Snake *snake)
-// {
-//     Point head = snake->head();
-//     return dangerPoints.at(0) == head
-//         || dangerPoints.at(1) == head
-//         || dangerPoints.at(2) == head
-//         || dangerPoints.at(3) == head
-//         || dangerPoints.at(4) == head
-//         || dangerPoints.at(5) == head;
-// }
-
-bool anyBigSnakeIsInOneOfTheseSpots(GameState &state, Point a, Point b)
-{
-    for (Snake *snake : state.enemies())
-    {
-        Point head = snake->head();
-        if (isTooBigForMeToEat(state, snake) && (head == a || head == b))
-        {
-            return true;
-        }
-    }
-    return false;
-}
-
-bool couldEndUpCornerAdjacentToBiggerSnake(
-    GameState &state,
-    std::array<Point, 4> &dangerPoints,
-    std::array<Point, 2> &dangerDestinationPoints)
-{
-    bool isOpen1 = spaceIsOpen(state, dangerDestinationPoints.at(0));
-    bool isOpen2 = spaceIsOpen(state, dangerDestinationPoints.at(1));
-
-    if (isOpen1 && anyBigSnakeIsInOneOfTheseSpots(state, dangerPoints.at(0), dangerPoints.at(1)))
-        return true;
-
-    if (isOpen2 && anyBigSnakeIsInOneOfTheseSpots(state, dangerPoints.at(2), dangerPoints.at(3)))
-        return true;
-
-    return false;
-}
-
 bool couldEndUpCornerAdjacentToBiggerSnake(GameState &state, Direction direction)
 {
-    Point me = state.mySnake()->head();
-    
-    if (direction == Direction::Up)
-    {
-        Point p2 = { me.x - 2, me.y - 2 };
-        Point p3 = { me.x - 1, me.y - 3 };
-
-        Point p4 = { me.x + 1, me.y - 3 };
-        Point p5 = { me.x + 2, me.y - 2 };
-
-        Point pt = { me.x - 1, me.y - 2 };
-
-        Point pu = { me.x + 1, me.y - 2 };
-
-        std::array<Point, 4> dangerPoints { p2, p3, p4, p5 };
-        std::array<Point, 2> dangerDestPoints { pt, pu };
-
-        return couldEndUpCornerAdjacentToBiggerSnake(
-            state, dangerPoints, dangerDestPoints);
-    }
-    else if (direction == Direction::Right)
-    {
-        Point p5 = { me.x + 2, me.y - 2 };
-        Point p6 = { me.x + 3, me.y - 1 };
-
-        Point p7 = { me.x + 3, me.y + 1 };
-        Point p8 = { me.x + 2, me.y + 2 };
-
-        Point pv = { me.x + 2, me.y - 1 };
-
-        Point pw = { me.x + 2, me.y + 1 };
-
-        std::array<Point, 4> dangerPoints { p5, p6, p7, p8 };
-        std::array<Point, 2> dangerDestPoints { pv, pw };
-
-        return couldEndUpCornerAdjacentToBiggerSnake(
-            state, dangerPoints, dangerDestPoints);
-    }
-    else if (direction == Direction::Down)
-    {
-        Point p8 = { me.x + 2, me.y + 2 };
-        Point p9 = { me.x + 1, me.y + 3 };
-
-        Point pa = { me.x - 1, me.y + 3 };
-        Point pb = { me.x - 2, me.y + 2 };
-
-        Point px = { me.x + 1, me.y + 2 };
-
-        Point py = { me.x - 1, me.y + 2 };
-
-        std::array<Point, 4> dangerPoints { p8, p9, pa, pb };
-        std::array<Point, 2> dangerDestPoints { px, py };
-
-        return couldEndUpCornerAdjacentToBiggerSnake(
-            state, dangerPoints, dangerDestPoints);
-    }
-    else
-    {
-        Point pb = { me.x - 2, me.y + 2 };
-        Point pc = { me.x - 3, me.y + 1 };
-
-        Point p1 = { me.x - 3, me.y - 1 };
-        Point p2 = { me.x - 2, me.y - 2 };
-
-        Point pz = { me.x - 2, me.y + 2 };
-
-        Point ps = { me.x - 1, me.y + 2 };
-
-        std::array<Point, 4> dangerPoints { pb, pc, p1, p2 };
-        std::array<Point, 2> dangerDestPoints { pz, ps };
-
-        return couldEndUpCornerAdjacentToBiggerSnake(
-            state, dangerPoints, dangerDestPoints);
-    }
-}
\ No newline at end of file
+    Point destination = coordAfterMove(state.mySnake()->head(), direction);
+    return cornerDanger(neighborhood(state, destination), direction);
+}
@@ -10,9 +10,13 @@
 #include <unordered_set>
 #include <memory>
 #include <algorithm>
+#include "timing.hpp"
 
 #define MAX_SNAKES 10
 
+// Slot of a snake that hasn't been given one yet (see GameState ctor).
+#define NO_SLOT UINT32_MAX
+
 enum class AxisBias
 {
     Vertical,
@@ -280,6 +284,10 @@ struct Snake
     std::vector<Point> parts;
     bool dead;
 
+    // Index that stays the same for the life of the snake even as other
+    // snakes die and get removed from World::snakes.
+    uint32_t slot = NO_SLOT;
+
     void prettyPrint();
     Point head();
     Point tail();
@@ -301,15 +309,10 @@ struct World
     std::string you;
     std::string id;
 
-    uint32_t spacesUp = 0;
-    uint32_t spacesDown = 0;
-    uint32_t spacesLeft = 0;
-    uint32_t spacesRight = 0;
-    
-    bool hasFoundSpacesUp = false;
-    bool hasFoundSpacesDown = false;
-    bool hasFoundSpacesLeft = false;
-    bool hasFoundSpacesRight = false;
+    // Zobrist hash (see zobrist.hpp). Set up by GameState and kept up to date
+    // by applyMoves().
+    uint64_t hash = 0;
+    bool hasHash = false;
 
     void prettyPrint();
 };
@@ -327,14 +330,44 @@ struct Metadata
 
 class GameState;
 
+// How much an algorithm can remember between moves of one snake in one
+// simulation.
+#define POLICY_STATE_WORDS 4
+
+// Scratch space that a simulation owns for each snake in it so that
+// algorithms can remember things from one move to the next without any
+// storage shared between threads. Starts out zeroed.
+struct PolicyState
+{
+    std::array<uint32_t, POLICY_STATE_WORDS> words {};
+};
+
+// Algorithms that are just one of the fixed policies in policy.hpp say which
+// so that simulations can run the policy directly.
+enum class PolicyKind
+{
+    Custom, Cautious, Hungry, Dog, Terminator
+};
+
 class Algorithm
 {
 public:
     Algorithm();
     virtual Metadata meta() = 0;
     virtual Direction move(GameState &) = 0;
-    virtual Direction move(GameState &state, uint32_t branchId);
+    virtual Direction move(GameState &state, PolicyState &policyState);
+
+    // Same as move() but with the time by which the answer has to be sent.
+    // Algorithms that don't care about time can ignore it.
+    virtual Direction move(GameState &state, const Deadline &deadline);
     virtual void start(std::string id) = 0;
+
+    // True if move(state, policyState) uses its policy state, in which case
+    // two branches that reach the same state could still play differently
+    // from there on.
+    virtual bool hasBranchState() { return false; }
+
+    virtual PolicyKind policyKind() { return PolicyKind::Custom; }
     uint32_t id() { return _id; }
 
 private:
@@ -366,6 +399,7 @@ public:
     // delete move and copy ctors for now to avoid accidental copies
     Map(const Map &) = delete;
     Map(Map &&) = delete;
+    ~Map();
 
     uint32_t turnsUntilVacant(Point p);
     Snake *getSnake(Point p);
@@ -395,6 +429,10 @@ public:
     GameState(const GameState &) = delete;
     GameState(GameState &&) = delete;
 
+    // Heap allocated states come from a per thread pool (see snakelib.cpp).
+    static void *operator new(size_t size);
+    static void operator delete(void *block, size_t size);
+
     uint32_t width() { return _width; }
     uint32_t height() { return _height; }
     World &world() { return _world; }
@@ -405,56 +443,40 @@ public:
     Map &map() { return _map; }
     AxisBias pathfindingBias() { return _pathfindingBias; }
     std::string gameId() { return _world.id; }
+    uint64_t hash() { return _world.hash; }
 
     GameState &perspective(Snake *enemy, AxisBias bias);
     std::unique_ptr<GameState> newStateAfterMoves(
         std::vector<SnakeMove> &moves);
     std::unique_ptr<GameState> clone();
 
-    uint32_t getSpacesUp() { 
-        if (_world.hasFoundSpacesUp) {
-            return _world.spacesUp;
-        } else {
-            _world.spacesUp = countAccessibleCellsAfterMove(*this, mySnake(), Direction::Up);
-            _world.hasFoundSpacesUp = true;
-            return _world.spacesUp;
-        }         
-    }
-
-    uint32_t getSpacesDown() { 
-        if (_world.hasFoundSpacesDown) {
-            return _world.spacesDown;
-        } else {
-            _world.spacesDown =countAccessibleCellsAfterMove(*this, mySnake(), Direction::Down);
-            _world.hasFoundSpacesDown = true;
-            return _world.spacesDown;
-        }         
-    }
+    bool isLoss();
 
-    uint32_t getSpacesLeft() { 
-        if (_world.hasFoundSpacesLeft) {
-            return _world.spacesLeft;
-        } else {
-            _world.spacesLeft = countAccessibleCellsAfterMove(*this, mySnake(), Direction::Left);
-            _world.hasFoundSpacesLeft = true;
-            return _world.spacesLeft;
-        }         
+    // Whether a cell is next to the head of an enemy at least as long as me
+    // (so it could eat me there) or shorter than me (so I could eat it). Both
+    // maps are built the first time either is asked for.
+    bool isNextToBiggerHead(uint32_t index)
+    {
+        return testHeadBit(_biggerHeads, index);
     }
 
-    uint32_t getSpacesRight() { 
-        if (_world.hasFoundSpacesRight) {
-            return _world.spacesRight;
-        } else {
-            _world.spacesRight = countAccessibleCellsAfterMove(*this, mySnake(), Direction::Right);
-            _world.hasFoundSpacesRight = true;
-            return _world.spacesRight;
-        }         
+    bool isNextToSmallerHead(uint32_t index)
+    {
+        return testHeadBit(_smallerHeads, index);
     }
 
-    bool isLoss();
-
 private:
     void removeSnake(Snake *snake);
+    void buildHeadMaps();
+
+    bool testHeadBit(std::vector<uint64_t> &bits, uint32_t index)
+    {
+        if (!_hasHeadMaps)
+        {
+            buildHeadMaps();
+        }
+        return index < _width * _height && (bits[index / 64] >> (index % 64)) & 1;
+    }
 
     uint32_t _width;
     uint32_t _height;
@@ -466,6 +488,9 @@ private:
     World _world;
     Map _map;
     AxisBias _pathfindingBias;
+    bool _hasHeadMaps;
+    std::vector<uint64_t> _biggerHeads;
+    std::vector<uint64_t> _smallerHeads;
 };
 
 inline Point coordAfterMove(Point p, Direction dir, int range = 1)
@@ -479,6 +504,17 @@ inline Point coordAfterMove(Point p, Direction dir, int range = 1)
     }
 }
 
+inline Direction oppositeDirection(Direction dir)
+{
+    switch (dir)
+    {
+        case Direction::Up: return Direction::Down;
+        case Direction::Down: return Direction::Up;
+        case Direction::Left: return Direction::Right;
+        default: return Direction::Left;
+    }
+}
+
 inline uint32_t cellIndex(Point p, uint32_t width)
 {
     return width * p.y + p.x;
@@ -551,16 +587,7 @@ inline bool isCloseToHead(uint32_t index, Snake *snake, GameState &state)
 
 inline bool isCloseToEqualOrBiggerSnakeHead(uint32_t index, GameState &state)
 {
-    auto enemies = state.enemies();
-    for (Snake *otherSnake : enemies)
-    {
-        bool otherSnakeIsTooBigToEat = state.mySnake()->length() <= otherSnake->length();
-        if (otherSnakeIsTooBigToEat && isCloseToHead(index, otherSnake, state))
-        {
-            return true;
-        }
-    }
-    return false;
+    return state.isNextToBiggerHead(index);
 }
 
 inline bool isCloseToEqualOrBiggerSnakeHead(Point p, GameState &state)
@@ -568,6 +595,11 @@ inline bool isCloseToEqualOrBiggerSnakeHead(Point p, GameState &state)
     return isCloseToEqualOrBiggerSnakeHead(cellIndex(p, state), state);
 }
 
+inline bool isCloseToSmallerSnakeHead(Point p, GameState &state)
+{
+    return state.isNextToSmallerHead(cellIndex(p, state));
+}
+
 inline uint32_t distance(Point a, Point b)
 {
     return absDiff(a.x, b.x) + absDiff(a.y, b.y);
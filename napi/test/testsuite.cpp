@@ -8,10 +8,27 @@
 #include "../astar.hpp"
 #include "../movement.hpp"
 #include "../simulator.hpp"
+#include "../rollout.hpp"
+#include "../policy.hpp"
+#include "../zobrist.hpp"
+#include "../transposition.hpp"
+#include "../log.hpp"
+#include "../matrixgame.hpp"
+#include "../bitboard.hpp"
+#include "../voronoi.hpp"
+#include "../evaluator.hpp"
+#include "../leaf.hpp"
+#include "../patterns.hpp"
 #include "../algorithms/sim.hpp"
 #include "../algorithms/inyourface.hpp"
 #include "../algorithms/cautious.hpp"
+#include "../algorithms/onedirection.hpp"
+#include "../algorithms/mcts.hpp"
+#include "../algorithms/paranoid.hpp"
 #include <iostream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
 
 class OneDirAlgorithm : public Algorithm
 {
@@ -43,6 +60,32 @@ private:
     Direction _dir;
 };
 
+// Plays like Cautious but counts how many moves it's been asked for.
+class CountingAlgorithm : public Algorithm
+{
+public:
+    CountingAlgorithm() : calls(0) { }
+
+    Metadata meta() override
+    {
+        return _cautious.meta();
+    }
+
+    void start(std::string /*id*/) override
+    { }
+
+    Direction move(GameState &state) override
+    {
+        calls++;
+        return _cautious.move(state);
+    }
+
+    uint32_t calls;
+
+private:
+    Cautious _cautious;
+};
+
 void parseWorldTest1()
 {
     World w = parseWorld({
@@ -419,6 +462,161 @@ void worldComparisonTest1()
     assertEqual(w1, w2, "world compare");
 }
 
+void zobristTest1()
+{
+    GameState state(parseWorld({
+        "> > 0 *",
+        "_ _ _ _",
+        "_ _ 2 <",
+        "_ 1 _ _",
+        "_ ^ < *"
+    }));
+
+    Snake *s0 = state.snakes()["0"];
+    Snake *s1 = state.snakes()["1"];
+    Snake *s2 = state.snakes()["2"];
+
+    // 0 eats and 2 gets eaten by 1 head on.
+    std::vector<SnakeMove> moves {
+        { s0, Direction::Right },
+        { s1, Direction::Up },
+        { s2, Direction::Left }
+    };
+    auto next = state.newStateAfterMoves(moves);
+
+    std::vector<SnakeMove> moreMoves {
+        { next->snakes()["0"], Direction::Down },
+        { next->snakes()["1"], Direction::Up }
+    };
+    auto after = next->newStateAfterMoves(moreMoves);
+
+    assertTrue(next->hash() == zobristWorld(next->world()), "zobristTest1() - eat and die");
+    assertTrue(after->hash() == zobristWorld(after->world()), "zobristTest1() - grow");
+    assertTrue(next->hash() != state.hash(), "zobristTest1() - hash changes");
+    assertEqual(next->world().snakes.size(), 2, "zobristTest1() - one died");
+
+    GameState &enemyState = after->perspective(after->snakes()["1"], AxisBias::Vertical);
+    assertTrue(enemyState.hash() == zobristWorld(enemyState.world()), "zobristTest1() - perspective");
+    assertTrue(enemyState.hash() != after->hash(), "zobristTest1() - you matters");
+}
+
+void zobristTest2()
+{
+    // The same position reached by two different move orders hashes the same.
+    GameState state(parseWorld({
+        "_ _ _ _ _",
+        "_ 0 _ _ _",
+        "_ _ _ _ _",
+        "_ _ _ _ _",
+        "_ _ _ 1 _"
+    }));
+
+    std::vector<SnakeMove> first {
+        { state.snakes()["0"], Direction::Right },
+        { state.snakes()["1"], Direction::Up }
+    };
+    auto a1 = state.newStateAfterMoves(first);
+    std::vector<SnakeMove> second {
+        { a1->snakes()["0"], Direction::Down },
+        { a1->snakes()["1"], Direction::Left }
+    };
+    auto a2 = a1->newStateAfterMoves(second);
+
+    std::vector<SnakeMove> firstSwapped {
+        { state.snakes()["0"], Direction::Down },
+        { state.snakes()["1"], Direction::Left }
+    };
+    auto b1 = state.newStateAfterMoves(firstSwapped);
+    std::vector<SnakeMove> secondSwapped {
+        { b1->snakes()["0"], Direction::Right },
+        { b1->snakes()["1"], Direction::Up }
+    };
+    auto b2 = b1->newStateAfterMoves(secondSwapped);
+
+    assertTrue(a1->hash() != b1->hash(), "zobristTest2() - different after one turn");
+    assertTrue(a2->hash() == b2->hash(), "zobristTest2() - same after two turns");
+}
+
+void transpositionTableTest1()
+{
+    TranspositionTable table(4);
+    uint64_t data = 0;
+
+    assertTrue(!table.probe(12345, data), "transpositionTableTest1() - empty miss");
+    table.store(12345, 42);
+    assertTrue(table.probe(12345, data), "transpositionTableTest1() - hit");
+    assertEqual(data, 42, "transpositionTableTest1() - data");
+
+    // Same slot, different key.
+    assertTrue(!table.probe(12345 + 4, data), "transpositionTableTest1() - other key misses");
+    table.store(12345 + 4, 7);
+    assertTrue(!table.probe(12345, data), "transpositionTableTest1() - replaced");
+
+    TranspositionStats stats = table.stats();
+    assertEqual(stats.probes, 4, "transpositionTableTest1() - probes");
+    assertEqual(stats.hits, 1, "transpositionTableTest1() - hits");
+    assertEqual(stats.collisions, 2, "transpositionTableTest1() - collisions");
+    assertEqual(stats.stores, 2, "transpositionTableTest1() - stores");
+}
+
+void transpositionTableTest2()
+{
+    TranspositionTable table(4);
+    uint64_t data = 0;
+    bool current = false;
+
+    // A deeper entry for another key keeps its slot within a generation.
+    table.store(12345, 42, 9);
+    table.store(12345 + 4, 7, 3);
+    assertTrue(table.probe(12345, data, current), "transpositionTableTest2() - kept");
+    assertEqual(data, 42, "transpositionTableTest2() - data");
+    assertTrue(current, "transpositionTableTest2() - current");
+
+    // Once the generation moves on it's still there but stale, and anything
+    // can replace it.
+    table.nextGeneration();
+    assertTrue(table.probe(12345, data, current), "transpositionTableTest2() - still there");
+    assertTrue(!current, "transpositionTableTest2() - stale");
+    table.store(12345 + 4, 7, 3);
+    assertTrue(!table.probe(12345, data), "transpositionTableTest2() - replaced");
+    assertTrue(table.probe(12345 + 4, data, current), "transpositionTableTest2() - new entry");
+    assertTrue(current, "transpositionTableTest2() - new entry current");
+}
+
+void loggerTest1()
+{
+    std::stringstream out;
+    {
+        Logger logger(8, out);
+        logger.setLevel(LogLevel::Info);
+        logger.write(LogLevel::Info, "one");
+        logger.write(LogLevel::Debug, "hidden");
+        logger.write(LogLevel::Error, "two");
+        logger.write(LogLevel::Info, std::string(LOG_MESSAGE_BYTES + 10, 'x'));
+        logger.flush();
+    }
+
+    std::string expected = "one\ntwo\n" + std::string(LOG_MESSAGE_BYTES, 'x') + "\n";
+    assertEqual(out.str(), expected, "loggerTest1() - in order, filtered and cut off");
+}
+
+void loggerTest2()
+{
+    std::stringstream out;
+    Logger logger(8, out);
+
+    // Give the flusher time to go to sleep. A message should wake it rather
+    // than waiting for its idle timeout.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto start = Clock::now();
+    logger.write(LogLevel::Info, "wake up");
+    logger.flush();
+    Seconds time = Clock::now() - start;
+
+    assertEqual(out.str(), std::string("wake up\n"), "loggerTest2() - written");
+    assertTrue(time.count() < 0.1, "loggerTest2() - woken straight away");
+}
+
 void newStateAfterMovesTest1()
 {
     GameState state(parseWorld({
@@ -642,7 +840,8 @@ void simulateFuturesTest1()
     AxisBias bias = AxisBias::Horizontal;
     AlgorithmBranch branch { pair, { Direction::Up }, bias };
     std::vector<AlgorithmBranch> branches { branch };
-    auto futures = runSimulationBranches(branches, state, 20, 1000);
+    auto futures = runSimulationBranches(
+        branches, state, 20, Deadline::fromNow(1000));
 
     assertEqual(futures.size(), 1, "simulateFuturesTest2() - one future");
     Future future = futures.at(0);
@@ -650,6 +849,317 @@ void simulateFuturesTest1()
     assertEqual(reason, TerminationReason::MaxTurns, "simulateFuturesTest2() - should lose");
 }
 
+void convergedBranchesTest1()
+{
+    GameState state(parseWorld({
+        "_ _ 1 _ _ _",
+        "_ _ ^ _ _ _",
+        "_ _ _ _ _ _",
+        "_ > > 0 _ _",
+        "_ _ _ _ * _",
+        "_ _ _ _ _ _"
+    }));
+
+    // Both enemy algorithms run into a wall within a few turns so from then
+    // on the two branches are exactly the same.
+    CountingAlgorithm me;
+    OneDirAlgorithm up(Direction::Up);
+    OneDirAlgorithm left(Direction::Left);
+    std::vector<AlgorithmBranch> branches {
+        { { &me, &up }, { Direction::Down }, AxisBias::Horizontal },
+        { { &me, &left }, { Direction::Down }, AxisBias::Vertical }
+    };
+
+    auto together = runSimulationBranches(
+        branches, state, 10, Deadline::fromNow(1000));
+    uint32_t togetherCalls = me.calls;
+
+    me.calls = 0;
+    std::vector<AlgorithmBranch> first { branches[0] };
+    std::vector<AlgorithmBranch> second { branches[1] };
+    auto alone1 = runSimulationBranches(first, state, 10, Deadline::fromNow(1000));
+    auto alone2 = runSimulationBranches(second, state, 10, Deadline::fromNow(1000));
+
+    assertEqual(together.size(), 2, "convergedBranchesTest1() - two futures");
+    assertEqual(together[0], alone1[0], "convergedBranchesTest1() - first");
+    assertEqual(together[1], alone2[0], "convergedBranchesTest1() - second");
+    assertTrue(branches[together[1].branch].pair.enemyAlgorithm == &left,
+        "convergedBranchesTest1() - keeps its own source");
+    assertTrue(togetherCalls < me.calls, "convergedBranchesTest1() - shared work");
+}
+
+void ponderTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _",
+        "_ > > 0 _ _ _ _",
+        "_ _ _ _ _ * _ _",
+        "_ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _",
+        "_ _ 1 < < _ _ _",
+        "_ _ _ _ _ _ _ _"
+    }));
+
+    Sim sim(100, 30, true);
+    Direction first = sim.move(state);
+    assertTrue(!sim.lastMoveWasPondered(), "ponderTest1() - nothing to start from");
+
+    // The request for the predicted state gets the pondered simulations.
+    std::unique_ptr<GameState> predicted = predictNextState(state, first);
+    sim.move(*predicted);
+    assertTrue(sim.lastMoveWasPondered(), "ponderTest1() - picks up pondering");
+
+    // Anything else starts over.
+    sim.move(state);
+    assertTrue(!sim.lastMoveWasPondered(), "ponderTest1() - different state");
+}
+
+void outOfTimeTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _",
+        "_ > > 0 _ _",
+        "_ _ _ _ * _",
+        "_ 1 < < _ _",
+        "_ _ _ _ _ _"
+    }));
+
+    Cautious cautious;
+    AlgorithmPair pair { &cautious, &cautious };
+    std::vector<AlgorithmBranch> branches {
+        { pair, { Direction::Up }, AxisBias::Horizontal },
+        { pair, { Direction::Down }, AxisBias::Horizontal },
+        { pair, { Direction::Right }, AxisBias::Vertical }
+    };
+
+    // Already out of time before starting.
+    auto futures = runSimulationBranches(
+        branches, state, 20, Deadline::fromNow(0));
+
+    assertEqual(futures.size(), 3, "outOfTimeTest1() - three futures");
+    for (Future &future : futures)
+    {
+        assertEqual(future.turns, 1, "outOfTimeTest1() - one turn each");
+        assertEqual(
+            future.terminationReason,
+            TerminationReason::OutOfTime,
+            "outOfTimeTest1() - out of time");
+    }
+    assertEqual(futures.at(1).move, Direction::Down, "outOfTimeTest1() - order kept");
+}
+
+void pruneDominatedTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _",
+        "_ > 0 _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ 1 _ _ _ _ _",
+        "_ _ _ _ ^ _ _ _ _ _",
+        "_ _ _ _ ^ _ _ _ _ _"
+    }));
+
+    // Going right twice runs head first into the bigger snake if it keeps
+    // going up, but going right then down is safe either way. So once the
+    // second arm has lasted long enough the first one can't be picked.
+    Cautious cautious;
+    OneDirAlgorithm up(Direction::Up);
+    OneDirAlgorithm left(Direction::Left);
+    Direction r = Direction::Right;
+    Direction d = Direction::Down;
+    std::vector<AlgorithmBranch> branches {
+        { { &cautious, &up }, { r, r }, AxisBias::Vertical },
+        { { &cautious, &left }, { r, r }, AxisBias::Vertical },
+        { { &cautious, &up }, { r, d }, AxisBias::Vertical },
+        { { &cautious, &left }, { r, d }, AxisBias::Vertical }
+    };
+
+    auto futures = runSimulationBranches(
+        branches, state, 40, Deadline::fromNow(1000));
+
+    assertEqual(futures.size(), 4, "pruneDominatedTest1() - four futures");
+    assertEqual(
+        futures[0].terminationReason,
+        TerminationReason::Loss,
+        "pruneDominatedTest1() - head on collision");
+    assertEqual(
+        futures[1].terminationReason,
+        TerminationReason::Pruned,
+        "pruneDominatedTest1() - rest of the arm is pruned");
+    assertTrue(futures[1].turns < 40, "pruneDominatedTest1() - stopped early");
+    assertEqual(futures[0].leafScore, 0, "pruneDominatedTest1() - no leaf score for a loss");
+    assertEqual(futures[1].leafScore, 0, "pruneDominatedTest1() - no leaf score without a horizon");
+    assertTrue(
+        futures[2].terminationReason != TerminationReason::Pruned
+            && futures[3].terminationReason != TerminationReason::Pruned,
+        "pruneDominatedTest1() - other arm keeps going");
+}
+
+void pruneDominatedTest2()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _",
+        "_ > 0 _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _ _ _",
+        "_ _ _ _ 1 _ _ _ _ _",
+        "_ _ _ _ ^ _ _ _ _ _",
+        "_ _ _ _ ^ _ _ _ _ _"
+    }));
+
+    // Same as pruneDominatedTest1() but through the thread pool, where the
+    // two arms that share a first move have to see each other no matter
+    // which threads end up running them.
+    SimThreadOptions original = SimThread::options;
+    SimThread::stopAll();
+    SimThread::options = { 4, false };
+    SimThread::startAll();
+
+    Cautious cautious;
+    OneDirAlgorithm up(Direction::Up);
+    OneDirAlgorithm left(Direction::Left);
+    Direction r = Direction::Right;
+    Direction d = Direction::Down;
+    SimulationHandle handle = simulateFuturesAsync(
+        state, 40, Deadline::fromNow(1000),
+        { { &cautious, { { r, r }, { r, d } } } },
+        { { &up, { } }, { &left, { } } });
+    SimulatorMetrics metrics = handle.metrics();
+    std::vector<Future> futures = handle.get();
+
+    SimThread::stopAll();
+    SimThread::options = original;
+    SimThread::startAll();
+
+    assertEqual(futures.size(), 8, "pruneDominatedTest2() - eight futures");
+    assertEqual(metrics.threads, 4, "pruneDominatedTest2() - four threads");
+    assertEqual(
+        metrics.terminations[static_cast<size_t>(TerminationReason::Pruned)],
+        2,
+        "pruneDominatedTest2() - rest of the arm is pruned");
+}
+
+void cheapRolloutMoveTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _",
+        "_ _ _ _ _ _",
+        "> > 0 _ _ *",
+        "_ _ _ _ _ _",
+        "_ _ _ 1 < <"
+    }));
+
+    FoodDistanceField field;
+    field.update(state);
+    assertEqual(field.at({ 5, 2 }, state), 0, "cheapRolloutMoveTest1() - food");
+    assertEqual(field.at({ 0, 0 }, state), 7, "cheapRolloutMoveTest1() - far corner");
+
+    Snake *me = state.mySnake();
+    assertEqual(cheapRolloutMove(state, me, field), Direction::Right,
+        "cheapRolloutMoveTest1() - towards food");
+
+    Snake *enemy = state.snakes()["1"];
+    assertEqual(cheapRolloutMove(state, enemy, field), Direction::Up,
+        "cheapRolloutMoveTest1() - enemy goes towards food");
+}
+
+void cheapTierTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _ _",
+        "_ > > 0 _ _ _ _",
+        "_ _ _ _ _ * _ _",
+        "_ _ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _ _",
+        "_ _ 1 < < _ _ _",
+        "_ _ _ _ _ _ _ _"
+    }));
+
+    CountingAlgorithm me;
+    CountingAlgorithm them;
+    std::vector<AlgorithmBranch> branches {
+        { { &me, &them }, { }, AxisBias::Vertical, 3 }
+    };
+
+    auto futures = runSimulationBranches(
+        branches, state, 30, Deadline::fromNow(1000));
+
+    assertEqual(futures.size(), 1, "cheapTierTest1() - one future");
+    assertTrue(futures[0].turns > 3, "cheapTierTest1() - keeps going");
+    assertEqual(me.calls, 3, "cheapTierTest1() - my algorithm for 3 turns");
+    assertEqual(them.calls, 3, "cheapTierTest1() - enemy algorithm for 3 turns");
+}
+
+void simulateFuturesAsyncTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _",
+        "_ > > 0 _ _",
+        "_ _ _ _ * _",
+        "_ 1 < < _ _",
+        "_ _ _ _ _ _"
+    }));
+
+    Cautious cautious;
+    std::vector<PrefixedAlgorithm> myAlgorithms {
+        { &cautious, { { Direction::Up }, { Direction::Down } } }
+    };
+    std::vector<PrefixedAlgorithm> enemyAlgorithms { { &cautious, { } } };
+
+    SimulationHandle handle = simulateFuturesAsync(
+        state, 10, Deadline::fromNow(1000), myAlgorithms, enemyAlgorithms);
+    bool ready = handle.waitUntil(Clock::now() + std::chrono::seconds(5));
+    std::vector<Future> futures = handle.get();
+
+    assertTrue(ready, "simulateFuturesAsyncTest1() - done before deadline");
+    assertTrue(handle.ready(), "simulateFuturesAsyncTest1() - still ready after get");
+    assertEqual(futures.size(), 4, "simulateFuturesAsyncTest1() - 2 prefixes x 2 biases");
+}
+
+void simulatorMetricsTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _",
+        "_ > > 0 _ _",
+        "_ _ _ _ * _",
+        "_ 1 < < _ _",
+        "_ _ _ _ _ _"
+    }));
+
+    Cautious cautious;
+    std::vector<PrefixedAlgorithm> myAlgorithms {
+        { &cautious, { { Direction::Up }, { Direction::Down } } }
+    };
+    std::vector<PrefixedAlgorithm> enemyAlgorithms { { &cautious, { } } };
+
+    SimulationHandle handle = simulateFuturesAsync(
+        state, 10, Deadline::fromNow(1000), myAlgorithms, enemyAlgorithms);
+    std::vector<Future> futures = handle.get();
+    SimulatorMetrics metrics = handle.metrics();
+
+    uint32_t turns = 0;
+    for (Future &future : futures)
+    {
+        turns += future.turns;
+    }
+
+    uint32_t terminations = 0;
+    for (uint32_t count : metrics.terminations)
+    {
+        terminations += count;
+    }
+
+    assertEqual(metrics.branches, 4, "simulatorMetricsTest1() - every branch counted");
+    assertEqual(terminations, 4, "simulatorMetricsTest1() - every termination counted");
+    assertTrue(metrics.threads > 0, "simulatorMetricsTest1() - threads counted");
+    assertTrue(metrics.turns > 0, "simulatorMetricsTest1() - turns counted");
+    assertTrue(metrics.turns <= turns, "simulatorMetricsTest1() - merged turns aren't simulated");
+    assertTrue(metrics.seconds > 0.0, "simulatorMetricsTest1() - timed");
+}
+
 void bestMoveTest1()
 {
     GameState state(parseWorld({
@@ -660,32 +1170,220 @@ void bestMoveTest1()
     }));
 
     OneDirAlgorithm algo(Direction::Up);
+    BranchTable branches { { { &algo, &algo }, { }, AxisBias::Vertical } };
+    uint32_t me = state.snakes()["0"]->slot;
+    uint32_t enemy = state.snakes()["1"]->slot;
 
     Future f1 {};
-    f1.obituaries = { { "1", 3 }, { "0", 4 } };
-    f1.foodsEaten = {};
+    f1.deathTurn.fill(NEVER);
+    f1.firstFoodTurn.fill(NEVER);
+    f1.deathTurn[enemy] = 3;
+    f1.deathTurn[me] = 4;
     f1.terminationReason = TerminationReason::Loss;
     f1.move = Direction::Left;
     f1.turns = 4;
-    f1.source = { { &algo, &algo }, { }, AxisBias::Vertical };
+    f1.branch = 0;
 
     Future f2 {};
-    f2.obituaries = { { "1", 3 }, { "0", 3 } };
-    f2.foodsEaten = {};
+    f2.deathTurn.fill(NEVER);
+    f2.firstFoodTurn.fill(NEVER);
+    f2.deathTurn[enemy] = 3;
+    f2.deathTurn[me] = 3;
     f2.terminationReason = TerminationReason::Loss;
     f2.move = Direction::Up;
     f2.turns = 3;
-    f2.source = { { &algo, &algo }, { }, AxisBias::Vertical };
+    f2.branch = 0;
 
     std::vector<Future> futures = { f1, f2 };
 
     std::cout << "---------bestMoveTest1---------\n";
-    Direction move = bestMove(futures, state);
+    Direction move = bestMove(futures, branches, state);
     std::cout << "---------/bestMoveTest1---------\n";
 
     assertEqual(move, Direction::Left, "bestMoveTest1() - left first");
 }
 
+void matrixGameTest1()
+{
+    // Matching pennies: no pure strategy is safe so both sides mix evenly.
+    MatrixGame pennies;
+    pennies.rows = 2;
+    pennies.cols = 2;
+    pennies.payoff[0][0] = 1.0;
+    pennies.payoff[0][1] = 0.0;
+    pennies.payoff[1][0] = 0.0;
+    pennies.payoff[1][1] = 1.0;
+    pennies.solve(1000);
+
+    assertTrue(std::abs(pennies.rowStrategy[0] - 0.5) < 0.01, "matrixGameTest1() - rows mixed");
+    assertTrue(std::abs(pennies.colStrategy[0] - 0.5) < 0.01, "matrixGameTest1() - cols mixed");
+    assertTrue(std::abs(pennies.value - 0.5) < 0.01, "matrixGameTest1() - value");
+
+    // The second row is never worse so it's the only one played, and the
+    // column that's worst for it is the only one played against it.
+    MatrixGame dominated;
+    dominated.rows = 2;
+    dominated.cols = 2;
+    dominated.payoff[0][0] = 0.2;
+    dominated.payoff[0][1] = 0.6;
+    dominated.payoff[1][0] = 0.4;
+    dominated.payoff[1][1] = 0.9;
+    dominated.solve(1000);
+
+    assertTrue(dominated.rowStrategy[1] > 0.99, "matrixGameTest1() - dominant row");
+    assertTrue(dominated.colStrategy[0] > 0.99, "matrixGameTest1() - worst column");
+    assertTrue(std::abs(dominated.value - 0.4) < 0.01, "matrixGameTest1() - saddle point");
+}
+
+void bestMoveTest2()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _",
+        "_ _ _ 0 _ _ _",
+        "_ _ _ ^ _ _ _",
+        "_ _ _ _ _ _ _",
+        "_ _ _ 1 < _ _"
+    }));
+
+    // The first two branches are the same group (same algorithm and prefix
+    // for me) even though they're different entries in the table.
+    OneDirAlgorithm mine(Direction::Up);
+    OneDirAlgorithm theirs1(Direction::Left);
+    OneDirAlgorithm theirs2(Direction::Right);
+    BranchTable branches {
+        { { &mine, &theirs1 }, { Direction::Left }, AxisBias::Vertical },
+        { { &mine, &theirs2 }, { Direction::Left }, AxisBias::Vertical },
+        { { &mine, &theirs1 }, { Direction::Right }, AxisBias::Vertical }
+    };
+    uint32_t me = state.snakes()["0"]->slot;
+    uint32_t enemy = state.snakes()["1"]->slot;
+
+    auto future = [](Direction move, uint32_t branch)
+    {
+        Future f {};
+        f.deathTurn.fill(NEVER);
+        f.firstFoodTurn.fill(NEVER);
+        f.terminationReason = TerminationReason::MaxTurns;
+        f.move = move;
+        f.turns = 20;
+        f.branch = branch;
+        return f;
+    };
+
+    // Best single future, but the same group also has an early loss.
+    Future killer = future(Direction::Left, 0);
+    killer.deathTurn[enemy] = 5;
+
+    Future loser = future(Direction::Left, 1);
+    loser.deathTurn[me] = 2;
+    loser.terminationReason = TerminationReason::Loss;
+    loser.turns = 2;
+
+    std::vector<Future> futures {
+        killer, future(Direction::Right, 2), loser
+    };
+
+    Direction move = bestMove(futures, branches, state);
+
+    assertEqual(move, Direction::Right, "bestMoveTest2() - worst case of each group");
+}
+
+struct NoIdea
+{
+    static MaybeDirection step(GameState &) { return MaybeDirection::none(); }
+};
+
+template <Direction D>
+struct Always
+{
+    static MaybeDirection step(GameState &) { return MaybeDirection::just(D); }
+};
+
+void policyCombinatorTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _",
+        "_ _ 0 < <",
+        "_ _ * _ _"
+    }));
+
+    typedef FirstOf<NoIdea, Always<Direction::Up>, Always<Direction::Left>> UpPolicy;
+    assertEqual(policyMove<UpPolicy>(state), Direction::Up,
+        "policyCombinatorTest1() - first one with an answer");
+    assertEqual(policyMove<FirstOf<NoIdea, CautiousPolicy>>(state), Direction::Down,
+        "policyCombinatorTest1() - nested");
+
+    Cautious cautious;
+    assertTrue(cautious.policyKind() == PolicyKind::Cautious,
+        "policyCombinatorTest1() - cautious has a policy");
+    assertEqual(policyMove(PolicyKind::Cautious, state), cautious.move(state),
+        "policyCombinatorTest1() - same as the algorithm");
+}
+
+void policyStateTest1()
+{
+    GameState blocked(parseWorld({
+        "0 < < _ _",
+        "_ _ _ _ _"
+    }));
+
+    // Left is open but cautious would go for the food.
+    GameState open(parseWorld({
+        "_ _ _ _ _",
+        "_ _ 0 < <",
+        "_ _ * _ _"
+    }));
+
+    OneDirection left(Direction::Left);
+    PolicyState stuck;
+    PolicyState fresh;
+    left.move(blocked, stuck);
+
+    assertEqual(left.move(open, stuck), Direction::Down,
+        "policyStateTest1() - gave up on left");
+    assertEqual(left.move(open, fresh), Direction::Left,
+        "policyStateTest1() - other snake still going left");
+}
+
+void policyStateTest2()
+{
+    World blockedWorld = parseWorld({
+        "0 < < _ _",
+        "_ _ _ _ _"
+    });
+    World openWorld = parseWorld({
+        "_ _ _ _ _",
+        "_ _ 0 < <",
+        "_ _ * _ _"
+    });
+
+    // Real games keep their own state too, even though they all share the
+    // one instance.
+    OneDirection left(Direction::Left);
+    left.start("stuck");
+    left.start("fresh");
+    blockedWorld.id = "stuck";
+    GameState blocked(blockedWorld);
+    left.move(blocked);
+
+    openWorld.id = "fresh";
+    GameState fresh(openWorld);
+    assertEqual(left.move(fresh), Direction::Left,
+        "policyStateTest2() - other game still going left");
+
+    openWorld.id = "stuck";
+    GameState stuck(openWorld);
+    assertEqual(left.move(stuck), Direction::Down,
+        "policyStateTest2() - gave up on left");
+
+    left.start("stuck");
+    GameState restarted(openWorld);
+    assertEqual(left.move(restarted), Direction::Left,
+        "policyStateTest2() - start() resets it");
+}
+
 void directionSetTests()
 {
     {
@@ -740,6 +1438,28 @@ void directionSetTests()
     }
 }
 
+void deadlineTests()
+{
+    Deadline deadline = Deadline::fromNow(100);
+    Deadline reserved = deadline.reserve(30);
+    Deadline extended = deadline.extend(30);
+
+    assertTrue(!deadline.expired(), "deadlineTests() - not expired yet");
+    assertTrue(deadline.remainingMillis() > 50, "deadlineTests() - time left");
+    assertTrue(reserved.at() < deadline.at(), "deadlineTests() - reserve is earlier");
+    assertTrue(extended.at() > deadline.at(), "deadlineTests() - extend is later");
+    assertTrue(
+        deadline.earliest(reserved).at() == reserved.at(),
+        "deadlineTests() - earliest picks other");
+    assertTrue(
+        reserved.earliest(deadline).at() == reserved.at(),
+        "deadlineTests() - earliest picks this");
+    assertTrue(deadline.reserve(200).expired(), "deadlineTests() - already passed");
+    assertTrue(
+        deadline.reserve(200).remainingMillis() < 0,
+        "deadlineTests() - negative remaining");
+}
+
 void arrayDictTest1()
 {
     ArrayDict<std::string, 10> test;
@@ -956,7 +1676,7 @@ void countAccessibleCellsTest_getter_1()
         "_ _ ^ < _",
     }));
 
-    uint32_t count = state.getSpacesLeft();
+    uint32_t count = FeatureTable(state).at(Direction::Left).accessible;
     assertEqual(count, 8, "countAccessibleCellsTest_getter_1() - 8 cells");
 }
 
@@ -969,7 +1689,7 @@ void countAccessibleCellsTest_getter_2()
         "_ _ _ _ _",
     }));
 
-    uint32_t count = state.getSpacesUp();
+    uint32_t count = FeatureTable(state).at(Direction::Up).accessible;
     assertEqual(count, 19, "countAccessibleCellsTest_getter_2() - 19 cells");
 }
 
@@ -980,10 +1700,274 @@ void countAccessibleCellsTest_getter_3()
         "> 0",
     }));
 
-    uint32_t count = state.getSpacesUp();
+    uint32_t count = FeatureTable(state).at(Direction::Up).accessible;
     assertEqual(count, 3, "countAccessibleCellsTest_getter_3() - 3 cells");
 }
 
+void featureTableTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _",
+        "_ > > 0 _ _",
+        "_ _ _ _ 1 _",
+        "_ _ _ _ ^ _",
+        "_ _ _ _ ^ *"
+    }));
+
+    FeatureTable features(state);
+    const MoveFeatures &right = features.at(Direction::Right);
+    const MoveFeatures &up = features.at(Direction::Up);
+
+    assertTrue(right.headToHeadRisk, "featureTableTest1() - right is next to a head");
+    assertTrue(!up.headToHeadRisk, "featureTableTest1() - up is not");
+    assertEqual(right.foodDistance, 4, "featureTableTest1() - food from right");
+    assertEqual(up.foodDistance, 6, "featureTableTest1() - food from up");
+    assertEqual(features.at(Direction::Left).accessible, 0, "featureTableTest1() - left is my neck");
+}
+
+void headMapsTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _",
+        "_ > > 0 _ _",
+        "_ _ _ _ 1 _",
+        "_ _ _ _ ^ _",
+        "2 < _ _ ^ _"
+    }));
+
+    // 1 is as long as me, 2 is shorter.
+    assertTrue(isCloseToEqualOrBiggerSnakeHead(Point { 4, 1 }, state), "headMapsTest1() - next to 1");
+    assertTrue(isCloseToEqualOrBiggerSnakeHead(Point { 5, 2 }, state), "headMapsTest1() - other side of 1");
+    assertTrue(!isCloseToEqualOrBiggerSnakeHead(Point { 4, 2 }, state), "headMapsTest1() - not 1's head itself");
+    assertTrue(!isCloseToEqualOrBiggerSnakeHead(Point { 0, 3 }, state), "headMapsTest1() - 2 can't eat me");
+    assertTrue(isCloseToSmallerSnakeHead(Point { 0, 3 }, state), "headMapsTest1() - I can eat 2");
+    assertTrue(!isCloseToSmallerSnakeHead(Point { 4, 1 }, state), "headMapsTest1() - I can't eat 1");
+    assertTrue(!isCloseToSmallerSnakeHead(Point { 0, 5 }, state), "headMapsTest1() - out of bounds");
+}
+
+void bitboardTest1()
+{
+    // Right next to the edge and on a word boundary.
+    BitboardLayout small(3, 3);
+    Bitboard corner;
+    corner.set(2);
+    Bitboard around;
+    small.neighbors(corner, around);
+    assertEqual(static_cast<uint32_t>(small.count(around)), 2, "bitboardTest1() - corner has two neighbours");
+    assertTrue(around.test(1) && around.test(5), "bitboardTest1() - left and down");
+    assertTrue(!around.test(3), "bitboardTest1() - no wrapping onto the next row");
+
+    BitboardLayout big(19, 19);
+    Bitboard middle;
+    middle.set(63);
+    big.neighbors(middle, around);
+    assertEqual(static_cast<uint32_t>(big.count(around)), 4, "bitboardTest1() - four neighbours across words");
+    assertTrue(around.test(62) && around.test(64), "bitboardTest1() - left and right");
+    assertTrue(around.test(44) && around.test(82), "bitboardTest1() - up and down");
+}
+
+void voronoiTest1()
+{
+    GameState state(parseWorld({
+        "> 0 _ _ _ 1 <",
+        "_ _ * _ _ _ _"
+    }));
+
+    // The middle column is as close to both of us so nobody gets it. My tail
+    // is free straight away.
+    Territory territory = voronoiTerritory(state);
+    assertEqual(static_cast<uint32_t>(territory.cells[0]), 5, "voronoiTest1() - my cells");
+    assertEqual(static_cast<uint32_t>(territory.cells[1]), 5, "voronoiTest1() - enemy cells");
+    assertEqual(static_cast<uint32_t>(territory.food[0]), 1, "voronoiTest1() - my food");
+    assertEqual(static_cast<uint32_t>(territory.food[1]), 0, "voronoiTest1() - enemy food");
+    assertEqual(static_cast<uint32_t>(territoryAdvantage(state)), VORONOI_FOOD_WEIGHT, "voronoiTest1() - advantage");
+}
+
+void voronoiTest2()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _",
+        "v < < < <",
+        "0 _ _ _ 1"
+    }));
+
+    // My body walls off the top row until it moves out of the way, which
+    // happens from the tail end so 1 gets there first.
+    Territory territory = voronoiTerritory(state);
+    assertEqual(static_cast<uint32_t>(territory.cells[0]), 2, "voronoiTest2() - my cells");
+    assertEqual(static_cast<uint32_t>(territory.cells[1]), 8, "voronoiTest2() - enemy cells");
+}
+
+void voronoiTest3()
+{
+    // Rows wider than a word, so a step up or down moves a cell more than one
+    // word along. Each of us is closer to every cell in our half.
+    std::vector<std::string> rows(10);
+    for (std::string &row : rows)
+    {
+        for (size_t x = 0; x < 100; x++)
+        {
+            row += x == 0 ? "_" : " _";
+        }
+    }
+    rows[0][2 * 50] = '0';
+    rows[9][2 * 50] = '1';
+
+    GameState state(parseWorld(rows));
+    Territory territory = voronoiTerritory(state);
+    assertEqual(static_cast<uint32_t>(territory.cells[0]), 499, "voronoiTest3() - my half");
+    assertEqual(static_cast<uint32_t>(territory.cells[1]), 499, "voronoiTest3() - enemy half");
+}
+
+void evaluatorTest1()
+{
+    GameState state(parseWorld({
+        "0 < _",
+        "_ _ *",
+        "_ _ 1"
+    }));
+
+    EvaluatorInputs inputs;
+    evaluatorInputs(state, state.mySnake(), inputs);
+
+    // My neck, 1's head (it's shorter than me), the food and everything in the
+    // window that's off the board.
+    uint32_t walls = EVALUATOR_WINDOW * EVALUATOR_WINDOW - 9;
+    assertEqual(static_cast<uint32_t>(inputs.count), 3 + walls, "evaluatorTest1() - active inputs");
+
+    uint32_t food = static_cast<uint32_t>(EvaluatorPlane::Food) * EVALUATOR_WINDOW * EVALUATOR_WINDOW
+        + (1 + EVALUATOR_RADIUS) * EVALUATOR_WINDOW + (2 + EVALUATOR_RADIUS);
+    uint32_t smallerHead = static_cast<uint32_t>(EvaluatorPlane::SmallerHead) * EVALUATOR_WINDOW * EVALUATOR_WINDOW
+        + (2 + EVALUATOR_RADIUS) * EVALUATOR_WINDOW + (2 + EVALUATOR_RADIUS);
+    auto has = [&inputs](uint32_t index)
+    {
+        return std::find(inputs.active.begin(), inputs.active.begin() + inputs.count, index)
+            != inputs.active.begin() + inputs.count;
+    };
+    assertTrue(has(food), "evaluatorTest1() - food");
+    assertTrue(has(smallerHead), "evaluatorTest1() - smaller head");
+    assertTrue(std::abs(inputs.scalars[1] - 0.1f) < 0.0001f, "evaluatorTest1() - one longer than the enemy");
+
+    // One hidden unit that likes the food being there and one that likes
+    // health.
+    std::stringstream weights;
+    weights << "evaluator " << EVALUATOR_RADIUS << " " << EVALUATOR_PLANES << " "
+        << EVALUATOR_SCALARS << " " << EVALUATOR_HIDDEN << "\n";
+    for (size_t h = 0; h < EVALUATOR_HIDDEN; h++)
+    {
+        weights << "0 ";
+    }
+    for (size_t i = 0; i < EVALUATOR_INPUTS; i++)
+    {
+        for (size_t h = 0; h < EVALUATOR_HIDDEN; h++)
+        {
+            bool foodWeight = i == food && h == 0;
+            bool healthWeight = i == EVALUATOR_PLANE_INPUTS && h == 1;
+            weights << (foodWeight ? "2 " : healthWeight ? "1 " : "0 ");
+        }
+    }
+    for (size_t h = 0; h < EVALUATOR_HIDDEN; h++)
+    {
+        weights << (h == 0 ? "1 " : h == 1 ? "0.5 " : "0 ");
+    }
+    weights << "-1";
+
+    Evaluator evaluator;
+    assertTrue(evaluator.load(weights), "evaluatorTest1() - loads");
+    assertTrue(evaluator.loaded(), "evaluatorTest1() - loaded");
+
+    float expected = 1.0f / (1.0f + std::exp(-(2.0f + 0.5f * state.mySnake()->health / 100.0f - 1.0f)));
+    float actual = evaluator.evaluate(state, state.mySnake());
+    assertTrue(std::abs(actual - expected) < 0.0001f, "evaluatorTest1() - evaluation");
+
+    std::stringstream wrongSize("evaluator 3 6 2 16 0 0 0");
+    Evaluator other;
+    assertTrue(!other.load(wrongSize), "evaluatorTest1() - wrong radius");
+    assertTrue(!other.loaded(), "evaluatorTest1() - still not loaded");
+}
+
+void leafScoreTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _",
+        "_ > > 0 _ _ _",
+        "_ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _",
+        "1 _ _ _ _ _ _"
+    }));
+
+    // Longer with more room and no food to worry about.
+    int32_t full = leafScore(state, 100);
+    int32_t hungry = leafScore(state, 50);
+    assertTrue(hungry > 0, "leafScoreTest1() - looks good for me");
+    assertEqual(static_cast<uint32_t>(full - hungry), 50 * LEAF_HEALTH_WEIGHT, "leafScoreTest1() - health");
+}
+
+void horizonTest1()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _",
+        "_ _ _ _ _ _",
+        "_ _ > 0 _ _",
+        "_ _ _ _ _ _",
+        "_ 1 < _ _ _",
+        "_ _ _ _ _ _"
+    }));
+
+    Cautious cautious;
+    AlgorithmPair pair { &cautious, &cautious };
+    AlgorithmBranch branch { pair, { Direction::Up }, AxisBias::Vertical };
+    std::vector<AlgorithmBranch> branches { branch };
+    auto futures = runSimulationBranches(
+        branches, state, 5, Deadline::fromNow(1000));
+
+    // Nobody dies before the horizon so it gets scored from where it ended
+    // up.
+    assertEqual(futures.at(0).terminationReason, TerminationReason::MaxTurns, "horizonTest1() - cut off");
+    assertTrue(futures.at(0).leafScore != 0, "horizonTest1() - has a leaf score");
+
+    GameState cornered(parseWorld({
+        "_ _ > > 0",
+        "_ _ _ _ _",
+        "_ _ _ _ _",
+        "_ _ _ _ _",
+        "1 < _ _ _"
+    }));
+
+    Sim sim(SIM_HORIZON_TURNS, 1000, false, true);
+    Direction move = sim.move(cornered);
+    assertEqual(move, Direction::Down, "horizonTest1() - only way out");
+}
+
+void horizonTest2()
+{
+    GameState state(parseWorld({
+        "_ _ _ _ _ _",
+        "_ _ _ _ _ _",
+        "_ _ > 0 _ _",
+        "_ _ _ _ _ _",
+        "_ 1 < _ _ _",
+        "_ _ _ _ _ _"
+    }));
+
+    // Already out of time so everything stops after its first turn, well
+    // short of maxTurns. Only with a horizon does that still get scored.
+    Cautious cautious;
+    for (bool horizon : { false, true })
+    {
+        std::vector<Future> futures = simulateFuturesAsync(
+            state, SIM_HORIZON_TURNS, Deadline::fromNow(0),
+            { { &cautious, { } } }, { { &cautious, { } } }, horizon).get();
+
+        assertEqual(futures.size(), 2, "horizonTest2() - both biases");
+        for (Future &future : futures)
+        {
+            assertEqual(future.terminationReason, TerminationReason::OutOfTime, "horizonTest2() - cut off early");
+            assertEqual(future.leafScore != 0, horizon, "horizonTest2() - leaf score only with a horizon");
+        }
+    }
+}
+
 void dontDie1()
 {
     GameState state(parseWorld({
@@ -1031,6 +2015,59 @@ void dontDie2()
     assertEqual(move, Direction::Right, "dontDie2() - Don't die");
 }
 
+void mctsDontDie1()
+{
+    GameState state(parseWorld({
+        "_ > 0 _ _ _ _",
+        "_ ^ < _ _ _ _",
+        "_ _ ^ _ * _ _",
+        "_ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _",
+        "_ _ _ _ _ 1 <"
+    }));
+
+    Mcts mcts(50, 20);
+    Direction move = mcts.move(state);
+    assertEqual(move, Direction::Right, "mctsDontDie1() - Don't die");
+    assertTrue(mcts.lastStats().iterations > 0, "mctsDontDie1() - searched");
+}
+
+void paranoidDontDie1()
+{
+    GameState state(parseWorld({
+        "_ > 0 _ _ _ _",
+        "_ ^ < _ _ _ _",
+        "_ _ ^ _ * _ _",
+        "_ _ _ _ _ _ _",
+        "_ _ _ _ _ _ _",
+        "_ _ _ _ _ 1 <"
+    }));
+
+    Paranoid paranoid(50);
+    Direction move = paranoid.move(state);
+    assertEqual(move, Direction::Right, "paranoidDontDie1() - Don't die");
+    assertTrue(paranoid.lastStats().depth > 0, "paranoidDontDie1() - searched");
+}
+
+void paranoidCutOff1()
+{
+    // Going up leads into a pocket that the enemy can seal off. Down has
+    // room to spare.
+    GameState state(parseWorld({
+        "_ _ _ _ _ _ _",
+        "v < < < < < _",
+        "v _ _ _ _ ^ _",
+        "> > 0 _ _ ^ _",
+        "_ _ _ _ _ ^ _",
+        "_ _ _ _ _ 1 _",
+        "_ _ _ _ _ _ _"
+    }));
+
+    Paranoid paranoid(100);
+    Direction move = paranoid.move(state);
+    assertTrue(move != Direction::Up, "paranoidCutOff1() - don't get sealed in");
+}
+
 void dontDie3()
 {
     GameState state(parseWorld({
@@ -1259,6 +2296,49 @@ void couldEndUpCornerAdjacentToBiggerSnakeTest4()
     assertEqual(downIsBad, false, "couldEndUpCornerAdjacentToBiggerSnakeTest2() - down is not bad");
 }
 
+void couldEndUpCornerAdjacentToBiggerSnakeTest5()
+{
+    GameState state(parseWorld({
+        "1 < _ _ _",
+        "_ _ _ _ _",
+        "_ _ 0 < _",
+        "_ _ _ _ _"
+    }));
+
+    // 1 could get to the cell above and to the left of where I'd be.
+    bool leftIsBad = couldEndUpCornerAdjacentToBiggerSnake(state, Direction::Left);
+    bool downIsBad = couldEndUpCornerAdjacentToBiggerSnake(state, Direction::Down);
+    assertEqual(leftIsBad, true, "couldEndUpCornerAdjacentToBiggerSnakeTest5() - left is bad");
+    assertEqual(downIsBad, false, "couldEndUpCornerAdjacentToBiggerSnakeTest5() - down is not bad");
+}
+
+void patternsTest1()
+{
+    GameState state(parseWorld({
+        "> 1 _ _ _",
+        "_ _ _ _ _",
+        "_ _ _ _ _",
+        "_ _ 0 < _"
+    }));
+
+    Neighborhood around = neighborhood(state, Point { 2, 1 });
+    assertEqual(around.biggerHeads, 1U << (1 * NEIGHBORHOOD_SIZE + 1), "patternsTest1() - 1's head");
+
+    // My neck is in the way to the right and the bottom edge is below.
+    TunnelStep fromHead = tunnelStep(neighborhood(state, Point { 2, 3 }), 2);
+    assertEqual(fromHead.ways, 2, "patternsTest1() - up and left from my head");
+    assertEqual(fromHead.last, Direction::Left, "patternsTest1() - left comes last");
+
+    TunnelStep pastNeck = tunnelStep(neighborhood(state, Point { 4, 3 }), 1);
+    assertEqual(pastNeck.ways, 1, "patternsTest1() - only up past my neck");
+    assertEqual(pastNeck.last, Direction::Up, "patternsTest1() - up");
+
+    // 1's head is above and the left edge is only one cell away.
+    TunnelStep besideEnemy = tunnelStep(neighborhood(state, Point { 1, 1 }), 2);
+    assertEqual(besideEnemy.ways, 2, "patternsTest1() - down and right");
+    assertEqual(besideEnemy.last, Direction::Right, "patternsTest1() - right comes last");
+}
+
 void simulateAccessibleCellsTest1()
 {
     GameState state(parseWorld({
@@ -1313,6 +2393,12 @@ void TestSuite::run()
     notImmediatelySuicidalTest2();
     worldComparisonTest1();
     newStateAfterMovesTest1();
+    zobristTest1();
+    zobristTest2();
+    transpositionTableTest1();
+    transpositionTableTest2();
+    loggerTest1();
+    loggerTest2();
     newStateAfterMovesTest2();
     newStateAfterMovesTest3();
     newStateAfterMovesTest4();
@@ -1320,8 +2406,23 @@ void TestSuite::run()
     newStateAfterMovesTest6();
     newStateAfterMovesTest7();
     simulateFuturesTest1();
+    outOfTimeTest1();
+    pruneDominatedTest1();
+    pruneDominatedTest2();
+    cheapRolloutMoveTest1();
+    cheapTierTest1();
+    ponderTest1();
+    convergedBranchesTest1();
+    simulateFuturesAsyncTest1();
+    simulatorMetricsTest1();
     bestMoveTest1();
+    bestMoveTest2();
+    matrixGameTest1();
     directionSetTests();
+    policyStateTest1();
+    policyStateTest2();
+    policyCombinatorTest1();
+    deadlineTests();
     arrayDictTest1();
     wideRectangleTest1();
     tallRectangleTest1();
@@ -1338,9 +2439,22 @@ void TestSuite::run()
     countAccessibleCellsTest_getter_1();
     countAccessibleCellsTest_getter_2();
     countAccessibleCellsTest_getter_3();
+    featureTableTest1();
+    headMapsTest1();
+    bitboardTest1();
+    voronoiTest1();
+    voronoiTest2();
+    voronoiTest3();
+    evaluatorTest1();
+    leafScoreTest1();
+    horizonTest1();
+    horizonTest2();
 
     dontDie1();
     dontDie2();
+    mctsDontDie1();
+    paranoidDontDie1();
+    paranoidCutOff1();
     dontDie3();
     dontDie4();
     dontDie5();
@@ -1352,6 +2466,8 @@ void TestSuite::run()
     couldEndUpCornerAdjacentToBiggerSnakeTest2();
     couldEndUpCornerAdjacentToBiggerSnakeTest3();
     couldEndUpCornerAdjacentToBiggerSnakeTest4();
+    couldEndUpCornerAdjacentToBiggerSnakeTest5();
+    patternsTest1();
     
     simulateAccessibleCellsTest1();
     simulateAccessibleCellsTest2();   
@@ -2,8 +2,67 @@
 
 #include <chrono>
 #include <functional>
+#include <string>
 
 typedef std::chrono::high_resolution_clock Clock;
 typedef std::chrono::duration<double> Seconds;
 
 void benchmark(std::string desc, std::function<void()> fn);
+
+// The time by which some piece of work has to be finished. It should be made
+// as early as possible (ie: when the request arrives) and passed down so that
+// each stage budgets against the time that's really left rather than a fixed
+// number of millis from whenever that stage happened to start.
+class Deadline
+{
+public:
+    Deadline() : _at(Clock::now())
+    { }
+
+    explicit Deadline(Clock::time_point at) : _at(at)
+    { }
+
+    static Deadline fromNow(uint32_t millis)
+    {
+        return after(Clock::now(), millis);
+    }
+
+    static Deadline after(Clock::time_point start, uint32_t millis)
+    {
+        return Deadline(start + std::chrono::milliseconds(millis));
+    }
+
+    Clock::time_point at() const { return _at; }
+
+    // Negative once the deadline has passed.
+    double remainingMillis() const
+    {
+        Seconds diff = _at - Clock::now();
+        return diff.count() * 1000.0;
+    }
+
+    bool expired() const
+    {
+        return Clock::now() >= _at;
+    }
+
+    // A deadline that leaves the given amount of time for whatever has to
+    // happen after this stage.
+    Deadline reserve(uint32_t millis) const
+    {
+        return Deadline(_at - std::chrono::milliseconds(millis));
+    }
+
+    Deadline extend(uint32_t millis) const
+    {
+        return Deadline(_at + std::chrono::milliseconds(millis));
+    }
+
+    Deadline earliest(const Deadline &other) const
+    {
+        return other._at < _at ? other : *this;
+    }
+
+private:
+    Clock::time_point _at;
+};
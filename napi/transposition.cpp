@@ -0,0 +1,115 @@
+#include "transposition.hpp"
+
+// 2^20 slots at 16 bytes each.
+#define SHARED_TRANSPOSITION_SLOTS (1 << 20)
+
+size_t roundUpToPowerOfTwo(size_t n)
+{
+    size_t result = 1;
+    while (result < n)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+TranspositionTable::TranspositionTable(size_t slots) :
+    _slots(roundUpToPowerOfTwo(slots)),
+    _mask(_slots.size() - 1),
+    _generation(0),
+    _probes(0),
+    _hits(0),
+    _collisions(0),
+    _stores(0)
+{
+    clear();
+}
+
+bool TranspositionTable::probe(uint64_t key, uint64_t &data)
+{
+    bool current;
+    return probe(key, data, current);
+}
+
+bool TranspositionTable::probe(uint64_t key, uint64_t &data, bool &current)
+{
+    _probes.fetch_add(1, std::memory_order_relaxed);
+
+    Slot &slot = _slots[key & _mask];
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    uint64_t value = slot.data.load(std::memory_order_relaxed);
+
+    if ((check ^ value) == key)
+    {
+        _hits.fetch_add(1, std::memory_order_relaxed);
+        data = value & ((1ULL << TRANSPOSITION_DATA_BITS) - 1);
+        current = (value >> TRANSPOSITION_GENERATION_SHIFT)
+            == _generation.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    // Something else is here (or a write was torn).
+    if (check != 0 || value != 0)
+    {
+        _collisions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, uint64_t data, uint8_t worth)
+{
+    uint64_t generation = _generation.load(std::memory_order_relaxed);
+    Slot &slot = _slots[key & _mask];
+    uint64_t oldCheck = slot.check.load(std::memory_order_relaxed);
+    uint64_t oldData = slot.data.load(std::memory_order_relaxed);
+
+    // Keep a more valuable entry for another key from this generation. A
+    // torn slot looks like another key, which is fine either way.
+    bool empty = oldCheck == 0 && oldData == 0;
+    if (!empty
+        && (oldCheck ^ oldData) != key
+        && (oldData >> TRANSPOSITION_GENERATION_SHIFT) == generation
+        && ((oldData >> TRANSPOSITION_WORTH_SHIFT) & 0xFF) > worth)
+    {
+        return;
+    }
+
+    _stores.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t value = (data & ((1ULL << TRANSPOSITION_DATA_BITS) - 1))
+        | static_cast<uint64_t>(worth) << TRANSPOSITION_WORTH_SHIFT
+        | generation << TRANSPOSITION_GENERATION_SHIFT;
+    slot.check.store(key ^ value, std::memory_order_relaxed);
+    slot.data.store(value, std::memory_order_relaxed);
+}
+
+void TranspositionTable::nextGeneration()
+{
+    _generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear()
+{
+    for (Slot &slot : _slots)
+    {
+        slot.check.store(0, std::memory_order_relaxed);
+        slot.data.store(0, std::memory_order_relaxed);
+    }
+    _probes = 0;
+    _hits = 0;
+    _collisions = 0;
+    _stores = 0;
+}
+
+TranspositionStats TranspositionTable::stats()
+{
+    return { _probes, _hits, _collisions, _stores };
+}
+
+TranspositionTable &TranspositionTable::shared()
+{
+    // Made on first use so that nothing pays for it unless it's needed.
+    static TranspositionTable table(SHARED_TRANSPOSITION_SLOTS);
+    return table;
+}
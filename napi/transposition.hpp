@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+
+// The table keeps the top of each slot's data for itself: the generation the
+// entry was stored in and how much it's worth keeping. Users get the rest.
+#define TRANSPOSITION_DATA_BITS 40
+#define TRANSPOSITION_WORTH_SHIFT 40
+#define TRANSPOSITION_GENERATION_SHIFT 48
+
+struct TranspositionStats
+{
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t collisions;
+    uint64_t stores;
+};
+
+// Fixed size hash table from a 64 bit key (eg: World::hash) to 40 bits of
+// whatever the user wants to pack in there. It's shared by all threads without
+// any locks. Each slot keeps key ^ data next to the data so that a probe can
+// tell when it's looking at a half written slot or somebody else's key and
+// treat it as a miss.
+//
+// Entries are stamped with the generation they were stored in, which moves on
+// every search (see nextGeneration). Anything from an earlier generation can
+// be replaced, and probes say so, since the state that made it might not be
+// covered by the key (eg: World::hash only has health to within a bucket of
+// ten, not exactly). Within a generation an entry is only replaced by the
+// same key or one that's worth at least as much (eg: searched at least as
+// deep).
+//
+// Different users of the shared table should mix something of their own into
+// their keys so they don't read each other's entries.
+class TranspositionTable
+{
+public:
+    // Size is rounded up to a power of two.
+    TranspositionTable(size_t slots);
+
+    bool probe(uint64_t key, uint64_t &data);
+    bool probe(uint64_t key, uint64_t &data, bool &current);
+    void store(uint64_t key, uint64_t data, uint8_t worth = 0);
+    void nextGeneration();
+    void clear();
+    TranspositionStats stats();
+
+    static TranspositionTable &shared();
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    std::vector<Slot> _slots;
+    uint64_t _mask;
+    std::atomic<uint16_t> _generation;
+    std::atomic<uint64_t> _probes;
+    std::atomic<uint64_t> _hits;
+    std::atomic<uint64_t> _collisions;
+    std::atomic<uint64_t> _stores;
+};
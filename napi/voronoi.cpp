@@ -0,0 +1,212 @@
+#include "voronoi.hpp"
+#include "bitboard.hpp"
+#include <algorithm>
+
+int32_t Territory::score(uint32_t slot) const
+{
+    size_t s = slot % MAX_SNAKES;
+    return cells[s] + VORONOI_FOOD_WEIGHT * food[s];
+}
+
+// Building a layout walks the whole board so each thread keeps the last one
+// around. Boards hardly ever change size.
+const BitboardLayout &layoutFor(uint32_t width, uint32_t height)
+{
+    static thread_local BitboardLayout layout(0, 0);
+    if (layout.width() != width || layout.height() != height)
+    {
+        layout = BitboardLayout(width, height);
+    }
+    return layout;
+}
+
+Territory voronoiTerritory(GameState &state)
+{
+    Territory result;
+    result.cells.fill(0);
+    result.food.fill(0);
+
+    const BitboardLayout &layout = layoutFor(state.width(), state.height());
+    if (!layout.fits())
+        return result;
+
+    size_t words = layout.words();
+    size_t reach = state.width() / 64 + 1;
+    std::array<Snake *, MAX_SNAKES> snakes;
+    std::array<Bitboard, MAX_SNAKES> owned;
+    size_t count = 0;
+    size_t longest = 0;
+    Bitboard blocked;
+    Bitboard claimed;
+    Bitboard food;
+
+    for (Snake &snake : state.world().snakes)
+    {
+        if (snake.parts.empty())
+            continue;
+
+        // Same as Map: the tail is free now and each part in front of it is
+        // free one turn later.
+        size_t length = snake.parts.size();
+        for (size_t i = 0; i + 1 < length; i++)
+        {
+            blocked.set(cellIndex(snake.parts[i], state));
+        }
+        longest = std::max(longest, length);
+
+        // Any snakes past MAX_SNAKES are just in the way.
+        if (count < MAX_SNAKES)
+        {
+            uint32_t head = cellIndex(snake.head(), state);
+            snakes[count] = &snake;
+            owned[count] = Bitboard();
+            owned[count].set(head);
+            claimed.set(head);
+            count++;
+        }
+    }
+
+    for (Point p : state.food())
+    {
+        food.set(cellIndex(p, state));
+    }
+
+    // Only cells a snake got last turn (its frontier) can lead anywhere new.
+    // Everything else it owns already had its neighbours claimed, except
+    // next to body parts that move out of the way later, so those get added
+    // back to the frontier when it happens. Each frontier also keeps the
+    // range of words it has bits in so that only the words around it get
+    // looked at.
+    std::array<Bitboard, MAX_SNAKES> frontier;
+    std::array<size_t, MAX_SNAKES> first;
+    std::array<size_t, MAX_SNAKES> last;
+    std::array<bool, MAX_SNAKES> growing;
+    for (size_t s = 0; s < count; s++)
+    {
+        frontier[s] = owned[s];
+        first[s] = cellIndex(snakes[s]->head(), state) / 64;
+        last[s] = first[s];
+        growing[s] = true;
+    }
+
+    std::array<Bitboard, MAX_SNAKES> reached;
+    for (size_t turn = 1; ; turn++)
+    {
+        // Parts that have been vacated by now.
+        for (size_t s = 0; s < count; s++)
+        {
+            std::vector<Point> &parts = snakes[s]->parts;
+            if (turn > parts.size())
+                continue;
+
+            Point vacated = parts[parts.size() - turn];
+            blocked.clear(cellIndex(vacated, state));
+            for (Direction direction : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+            {
+                Point next = coordAfterMove(vacated, direction);
+                if (outOfBounds(next, state))
+                    continue;
+
+                uint32_t index = cellIndex(next, state);
+                for (size_t o = 0; o < count; o++)
+                {
+                    if (!owned[o].test(index))
+                        continue;
+
+                    frontier[o].set(index);
+                    size_t word = index / 64;
+                    first[o] = growing[o] ? std::min(first[o], word) : word;
+                    last[o] = growing[o] ? std::max(last[o], word) : word;
+                    growing[o] = true;
+                }
+            }
+        }
+
+        // Everything a frontier reaches is within a row of it, which is a
+        // word either side for boards up to a word wide and more than that
+        // for wider ones.
+        for (size_t s = 0; s < count; s++)
+        {
+            if (!growing[s])
+                continue;
+
+            first[s] = first[s] > reach ? first[s] - reach : 0;
+            last[s] = std::min(last[s] + reach, words - 1);
+        }
+
+        Bitboard once;
+        Bitboard twice;
+        for (size_t s = 0; s < count; s++)
+        {
+            if (!growing[s])
+                continue;
+
+            layout.neighbors(frontier[s], reached[s], first[s], last[s]);
+            for (size_t i = first[s]; i <= last[s]; i++)
+            {
+                uint64_t open = reached[s].words[i]
+                    & ~blocked.words[i]
+                    & ~claimed.words[i];
+                reached[s].words[i] = open;
+                twice.words[i] |= once.words[i] & open;
+                once.words[i] |= open;
+            }
+        }
+
+        // What each snake got to first becomes its new frontier. The old one
+        // only had bits within the range so this replaces all of it.
+        bool any = false;
+        for (size_t s = 0; s < count; s++)
+        {
+            if (!growing[s])
+                continue;
+
+            size_t slot = snakes[s]->slot % MAX_SNAKES;
+            size_t from = first[s];
+            size_t to = last[s];
+            growing[s] = false;
+            for (size_t i = from; i <= to; i++)
+            {
+                uint64_t mine = reached[s].words[i] & ~twice.words[i];
+                frontier[s].words[i] = mine;
+                if (mine == 0)
+                    continue;
+
+                owned[s].words[i] |= mine;
+                result.cells[slot] += __builtin_popcountll(mine);
+                result.food[slot] += __builtin_popcountll(mine & food.words[i]);
+                first[s] = growing[s] ? first[s] : i;
+                last[s] = i;
+                growing[s] = true;
+            }
+            any = any || growing[s];
+        }
+
+        for (size_t i = 0; i < words; i++)
+        {
+            claimed.words[i] |= once.words[i];
+        }
+
+        // Every frontier is empty and no more body parts are going to move
+        // out of the way.
+        if (!any && turn >= longest)
+            break;
+    }
+
+    return result;
+}
+
+int32_t territoryAdvantage(GameState &state)
+{
+    Territory territory = voronoiTerritory(state);
+    Snake *me = state.mySnake();
+    if (me == nullptr)
+        return 0;
+
+    int32_t best = 0;
+    for (Snake *enemy : state.enemies())
+    {
+        best = std::max(best, territory.score(enemy->slot));
+    }
+    return territory.score(me->slot) - best;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "snakelib.hpp"
+#include <array>
+
+// How many cells one food in a snake's territory is worth.
+#define VORONOI_FOOD_WEIGHT 3
+
+// The cells each snake can get to strictly before every other snake (cells
+// two snakes reach at the same time belong to nobody), counting body cells as
+// open from the turn they'll be vacated. Indexed by slot.
+struct Territory
+{
+    std::array<uint16_t, MAX_SNAKES> cells;
+    std::array<uint16_t, MAX_SNAKES> food;
+
+    // Cells plus food, weighted by VORONOI_FOOD_WEIGHT.
+    int32_t score(uint32_t slot) const;
+};
+
+// Expands every snake's territory a step at a time over bitboards, so a 19x19
+// board with four snakes takes a few microseconds. Boards too big for a
+// Bitboard come back empty.
+Territory voronoiTerritory(GameState &state);
+
+// My territory score minus the best enemy's. Meant as a leaf evaluation for
+// rollouts that stop early and for tree search.
+int32_t territoryAdvantage(GameState &state);
@@ -0,0 +1,107 @@
+#include "zobrist.hpp"
+
+#include <random>
+
+struct ZobristKeys
+{
+    ZobristKeys()
+    {
+        // Fixed seed so hashes are the same from run to run, which keeps
+        // anything built on them deterministic.
+        std::mt19937_64 rng(0x5a0b5157);
+        for (size_t s = 0; s < MAX_SNAKES; s++)
+        {
+            for (size_t c = 0; c < ZOBRIST_MAX_CELLS; c++)
+            {
+                head[s][c] = rng();
+                body[s][c] = rng();
+                tail[s][c] = rng();
+            }
+            for (size_t h = 0; h < ZOBRIST_HEALTH_BUCKETS; h++)
+            {
+                health[s][h] = rng();
+            }
+            you[s] = rng();
+        }
+        for (size_t c = 0; c < ZOBRIST_MAX_CELLS; c++)
+        {
+            food[c] = rng();
+        }
+    }
+
+    std::array<std::array<uint64_t, ZOBRIST_MAX_CELLS>, MAX_SNAKES> head;
+    std::array<std::array<uint64_t, ZOBRIST_MAX_CELLS>, MAX_SNAKES> body;
+    std::array<std::array<uint64_t, ZOBRIST_MAX_CELLS>, MAX_SNAKES> tail;
+    std::array<std::array<uint64_t, ZOBRIST_HEALTH_BUCKETS>, MAX_SNAKES> health;
+    std::array<uint64_t, MAX_SNAKES> you;
+    std::array<uint64_t, ZOBRIST_MAX_CELLS> food;
+};
+
+static const ZobristKeys keys;
+
+uint64_t zobristHead(uint32_t slot, uint32_t cell)
+{
+    return keys.head[slot % MAX_SNAKES][cell % ZOBRIST_MAX_CELLS];
+}
+
+uint64_t zobristBody(uint32_t slot, uint32_t cell)
+{
+    return keys.body[slot % MAX_SNAKES][cell % ZOBRIST_MAX_CELLS];
+}
+
+uint64_t zobristTail(uint32_t slot, uint32_t cell)
+{
+    return keys.tail[slot % MAX_SNAKES][cell % ZOBRIST_MAX_CELLS];
+}
+
+uint64_t zobristHealth(uint32_t slot, uint32_t health)
+{
+    uint32_t bucket = std::min<uint32_t>(health / 10, ZOBRIST_HEALTH_BUCKETS - 1);
+    return keys.health[slot % MAX_SNAKES][bucket];
+}
+
+uint64_t zobristFood(uint32_t cell)
+{
+    return keys.food[cell % ZOBRIST_MAX_CELLS];
+}
+
+uint64_t zobristYou(uint32_t slot)
+{
+    return keys.you[slot % MAX_SNAKES];
+}
+
+uint64_t zobristSnake(World &world, Snake &snake)
+{
+    uint64_t hash = zobristHealth(snake.slot, snake.health);
+    if (snake.id == world.you)
+    {
+        hash ^= zobristYou(snake.slot);
+    }
+
+    if (snake.parts.empty())
+    {
+        return hash;
+    }
+
+    hash ^= zobristHead(snake.slot, cellIndex(snake.head(), world.width));
+    hash ^= zobristTail(snake.slot, cellIndex(snake.tail(), world.width));
+    for (size_t i = 1; i < snake.parts.size(); i++)
+    {
+        hash ^= zobristBody(snake.slot, cellIndex(snake.parts[i], world.width));
+    }
+    return hash;
+}
+
+uint64_t zobristWorld(World &world)
+{
+    uint64_t hash = 0;
+    for (Snake &snake : world.snakes)
+    {
+        hash ^= zobristSnake(world, snake);
+    }
+    for (Point food : world.food)
+    {
+        hash ^= zobristFood(cellIndex(food, world.width));
+    }
+    return hash;
+}
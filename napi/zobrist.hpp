@@ -0,0 +1,30 @@
+#pragma once
+
+#include "snakelib.hpp"
+
+// Zobrist keys for World. Each thing that can be on the board (a snake's head,
+// its body, its tail, its health bucket, food, which snake is "you") gets a
+// random 64 bit key and the hash of a world is all of its keys xored together.
+// That makes it cheap to update as the world changes since removing a thing
+// is the same as adding it.
+//
+// Snakes are identified by their slot rather than their id so that the same
+// position hashes the same way no matter what the snakes are called. Boards
+// bigger than ZOBRIST_MAX_CELLS cells still work but share keys between cells
+// so they collide more.
+
+#define ZOBRIST_MAX_CELLS 1024
+#define ZOBRIST_HEALTH_BUCKETS 11
+
+uint64_t zobristHead(uint32_t slot, uint32_t cell);
+uint64_t zobristBody(uint32_t slot, uint32_t cell);
+uint64_t zobristTail(uint32_t slot, uint32_t cell);
+uint64_t zobristHealth(uint32_t slot, uint32_t health);
+uint64_t zobristFood(uint32_t cell);
+uint64_t zobristYou(uint32_t slot);
+
+// Everything that the given snake contributes to the world hash.
+uint64_t zobristSnake(World &world, Snake &snake);
+
+// Full hash from scratch. Snakes must already have slots.
+uint64_t zobristWorld(World &world);
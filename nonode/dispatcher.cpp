@@ -4,10 +4,14 @@
 #include "timing.hpp"
 #include "snakelib.hpp"
 #include "dispatcher.hpp"
+#include "simulator.hpp"
+#include "log.hpp"
 #include "json.hpp"
 
 Algorithm *Dispatcher::algorithm = nullptr;
 
+uint32_t Dispatcher::moveBudgetMillis = 160;
+
 std::string getGameId(std::string json)
 {
     auto j = nlohmann::json::parse(json);
@@ -71,13 +75,13 @@ World getWorld(std::string json)
     return w;
 }
 
-std::string Dispatcher::move(std::string json)
+std::string Dispatcher::move(std::string json, Deadline deadline)
 {
     auto start = Clock::now();
 
     World world = getWorld(json);
     GameState state(world);
-    Direction direction = Dispatcher::algorithm->move(state);
+    Direction direction = Dispatcher::algorithm->move(state, deadline);
 
     nlohmann::json jsonResult = {
         { "move", directionToString(direction) }
@@ -87,7 +91,8 @@ std::string Dispatcher::move(std::string json)
     Seconds diff = end - start;
     auto millis = diff.count() * 1000.0;
 
-    std::cout << millis << " millis" << std::endl;
+    LOG(LogLevel::Info) << millis << " millis (" << deadline.remainingMillis()
+        << " to spare)";
 
     return jsonResult.dump();
 }
@@ -111,4 +116,30 @@ std::string Dispatcher::start(std::string json)
     return jsonResult.dump();
 }
 
+std::string Dispatcher::metrics()
+{
+    SimulatorMetrics metrics = latestSimulatorMetrics();
+
+    nlohmann::json terminations;
+    for (size_t i = 0; i < metrics.terminations.size(); i++)
+    {
+        auto reason = static_cast<TerminationReason>(i);
+        terminations[terminationReasonToString(reason)] = metrics.terminations[i];
+    }
+
+    nlohmann::json jsonResult = {
+        { "branches", metrics.branches },
+        { "turns", metrics.turns },
+        { "threads", metrics.threads },
+        { "seconds", metrics.seconds },
+        { "turns_per_second_per_thread", metrics.turnsPerSecondPerThread() },
+        { "policy_seconds", metrics.policySeconds },
+        { "rules_seconds", metrics.rulesSeconds },
+        { "state_seconds", metrics.stateSeconds },
+        { "terminations", terminations }
+    };
+
+    return jsonResult.dump();
+}
+
 //curl -d '{"game_id": 1234}' -H "Content-Type: application/json" -X POST http://localhost:5000/start
@@ -2,12 +2,19 @@
 
 #include <string>
 #include "snakelib.hpp"
+#include "timing.hpp"
 
 class Dispatcher
 {
 public:
-    static std::string move(std::string json);
+    static std::string move(std::string json, Deadline deadline);
     static std::string start(std::string json);
 
+    // What the simulator got done on the last move.
+    static std::string metrics();
+
     static Algorithm *algorithm;
+
+    // How long we have to answer a /move, counted from when it arrives.
+    static uint32_t moveBudgetMillis;
 };
@@ -0,0 +1,207 @@
+// Plays games between snakes using the cheap rollout policy and writes every
+// position out as training data for the evaluator (see evaluator.hpp), eg:
+//   ./exporter 1000 7 > positions.txt
+//
+// There's one line per snake per turn:
+//   <won> <scalars...> <active plane inputs...>
+// where won is 1 if the snake was still alive when the game ended.
+// Fitting the weights happens outside the bot.
+
+#include "snakelib.hpp"
+#include "rollout.hpp"
+#include "evaluator.hpp"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+// Board size and snake count for the generated games.
+#define EXPORT_BOARD_SIZE 11
+#define EXPORT_SNAKES 4
+
+// Games that go on longer than this are stopped with every survivor winning.
+#define EXPORT_MAX_TURNS 300
+
+// Percent chance each turn of a snake making a random (in bounds and not
+// obviously fatal) move instead of the policy's, so the data isn't all from
+// the same handful of lines.
+#define EXPORT_RANDOM_MOVE_PERCENT 10
+
+// Percent chance each turn of new food when there's less than one per snake.
+#define EXPORT_FOOD_SPAWN_PERCENT 15
+
+uint32_t randomBelow(uint32_t n)
+{
+    return static_cast<uint32_t>(rand()) % n;
+}
+
+bool occupied(World &world, Point p)
+{
+    for (Snake &snake : world.snakes)
+    {
+        for (Point part : snake.parts)
+        {
+            if (part == p)
+                return true;
+        }
+    }
+    return std::find(world.food.begin(), world.food.end(), p) != world.food.end();
+}
+
+void spawnFood(World &world)
+{
+    // Give up after a few tries if the board is crowded.
+    for (int attempt = 0; attempt < 20; attempt++)
+    {
+        Point p { randomBelow(world.width), randomBelow(world.height) };
+        if (!occupied(world, p))
+        {
+            world.food.push_back(p);
+            return;
+        }
+    }
+}
+
+World startingWorld(uint32_t game)
+{
+    World world;
+    world.width = EXPORT_BOARD_SIZE;
+    world.height = EXPORT_BOARD_SIZE;
+    world.id = "export-" + std::to_string(game);
+
+    uint32_t far = EXPORT_BOARD_SIZE - 2;
+    Point starts[] = { { 1, 1 }, { far, 1 }, { 1, far }, { far, far } };
+    for (uint32_t i = 0; i < EXPORT_SNAKES; i++)
+    {
+        Snake snake;
+        snake.id = std::to_string(i);
+        snake.health = 100;
+        snake.parts = { starts[i], starts[i], starts[i] };
+        snake.dead = false;
+        world.snakes.push_back(snake);
+    }
+
+    world.food.push_back({ EXPORT_BOARD_SIZE / 2, EXPORT_BOARD_SIZE / 2 });
+    for (uint32_t i = 0; i < EXPORT_SNAKES; i++)
+    {
+        spawnFood(world);
+    }
+    return world;
+}
+
+Direction randomMove(GameState &state, Snake *snake, Direction fallback)
+{
+    Direction options[4];
+    uint32_t count = 0;
+    for (Direction direction : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+    {
+        Point p = coordAfterMove(snake->head(), direction);
+        if (!outOfBounds(p, state) && state.map().turnsUntilVacant(p) == 0)
+        {
+            options[count++] = direction;
+        }
+    }
+    return count == 0 ? fallback : options[randomBelow(count)];
+}
+
+// Health isn't something applyMoves() deals with so it's done here: eating
+// fills it back up, otherwise it goes down by one and the snake starves at
+// zero.
+void updateHealth(World &world, std::vector<Point> &foodBefore)
+{
+    for (Snake &snake : world.snakes)
+    {
+        bool ate = std::find(foodBefore.begin(), foodBefore.end(), snake.head())
+            != foodBefore.end();
+        snake.health = ate ? 100 : snake.health - 1;
+        snake.dead = snake.health == 0;
+    }
+
+    world.snakes.erase(
+        std::remove_if(world.snakes.begin(), world.snakes.end(),
+            [](const Snake &s) { return s.dead; }),
+        world.snakes.end());
+}
+
+void writeLine(std::ostream &out, const std::string &id, const EvaluatorInputs &inputs)
+{
+    out << id;
+    for (float scalar : inputs.scalars)
+    {
+        out << ' ' << scalar;
+    }
+    for (size_t i = 0; i < inputs.count; i++)
+    {
+        out << ' ' << inputs.active[i];
+    }
+    out << '\n';
+}
+
+void playGame(uint32_t game, std::ostream &out)
+{
+    World world = startingWorld(game);
+    FoodDistanceField field;
+
+    // Lines are kept until the end of the game when it's known who won, with
+    // the snake id standing in for the label until then.
+    std::vector<std::string> lines;
+    EvaluatorInputs inputs;
+
+    for (uint32_t turn = 0; turn < EXPORT_MAX_TURNS && world.snakes.size() > 1; turn++)
+    {
+        GameState state(world);
+        field.update(state);
+
+        std::vector<SnakeMove> moves;
+        for (Snake &snake : state.world().snakes)
+        {
+            evaluatorInputs(state, &snake, inputs);
+            std::ostringstream line;
+            writeLine(line, snake.id, inputs);
+            lines.push_back(line.str());
+
+            Direction move = cheapRolloutMove(state, &snake, field);
+            if (randomBelow(100) < EXPORT_RANDOM_MOVE_PERCENT)
+            {
+                move = randomMove(state, &snake, move);
+            }
+            moves.push_back({ &snake, move });
+        }
+
+        std::vector<Point> foodBefore = world.food;
+        applyMoves(world, moves);
+        updateHealth(world, foodBefore);
+
+        if (world.food.size() < EXPORT_SNAKES
+            && randomBelow(100) < EXPORT_FOOD_SPAWN_PERCENT)
+        {
+            spawnFood(world);
+        }
+    }
+
+    for (std::string &line : lines)
+    {
+        size_t space = line.find(' ');
+        std::string id = line.substr(0, space);
+        bool won = std::any_of(world.snakes.begin(), world.snakes.end(),
+            [&id](const Snake &s) { return s.id == id; });
+        out << (won ? '1' : '0') << line.substr(space);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: exporter <games> [seed]" << std::endl;
+        return 1;
+    }
+
+    uint32_t games = std::max(atoi(argv[1]), 0);
+    srand(argc > 2 ? atoi(argv[2]) : 1);
+
+    for (uint32_t game = 0; game < games; game++)
+    {
+        playGame(game, std::cout);
+    }
+}
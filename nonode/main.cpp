@@ -1,10 +1,13 @@
 #include <iostream>
+#include <algorithm>
 #include <string>
 #include <boost/asio.hpp>
 #include "server.hpp"
 #include "simulator.hpp"
 #include "dispatcher.hpp"
 #include "algorithms.hpp"
+#include "log.hpp"
+#include "evaluator.hpp"
 
 #include <stdio.h>
 #include <execinfo.h>
@@ -26,9 +29,51 @@ void handler(int sig)
     exit(1);
 }
 
+// Simulation threads can be set up from the environment, eg:
+//   SIM_THREADS=3 SIM_PIN=1 ./snakebot 5000 sim
+void readSimThreadOptions()
+{
+    const char *threads = getenv("SIM_THREADS");
+    if (threads != nullptr)
+    {
+        SimThread::options.threads = std::max(atoi(threads), 0);
+    }
+
+    const char *pin = getenv("SIM_PIN");
+    if (pin != nullptr)
+    {
+        SimThread::options.pin = atoi(pin) != 0;
+    }
+}
+
+// One of debug, info, warning, error or none, eg:
+//   LOG_LEVEL=debug ./snakebot 5000 sim
+void readLogLevel()
+{
+    const char *level = getenv("LOG_LEVEL");
+    if (level != nullptr)
+    {
+        Logger::shared().setLevel(logLevelFromString(level));
+    }
+}
+
+// Weights for the position evaluator (see evaluator.hpp), eg:
+//   EVALUATOR_WEIGHTS=weights.txt ./snakebot 5000 sim
+void readEvaluatorWeights()
+{
+    const char *path = getenv("EVALUATOR_WEIGHTS");
+    if (path != nullptr && Evaluator::shared().load(path))
+    {
+        LOG(LogLevel::Info) << "Loaded evaluator weights from " << path;
+    }
+}
+
 int main(int argc, char* argv[])
 {
     signal(SIGSEGV, handler);
+    readSimThreadOptions();
+    readLogLevel();
+    readEvaluatorWeights();
 
     try
     {
@@ -71,6 +116,7 @@ int main(int argc, char* argv[])
     }
 
     SimThread::stopAll();
+    Logger::shared().flush();
 
     return 0;
 }
@@ -15,14 +15,39 @@
 #include <utility>
 #include <vector>
 
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
 namespace http {
 namespace server {
 
+// How long ago the kernel got the latest bytes on the socket, ie: how long
+// they've been waiting for this thread (eg: behind another connection's
+// request). Zero where there's no way to tell.
+static uint32_t queued_millis(boost::asio::ip::tcp::socket& socket)
+{
+#ifdef __linux__
+  struct tcp_info info;
+  socklen_t length = sizeof(info);
+  if (getsockopt(socket.native_handle(), IPPROTO_TCP, TCP_INFO,
+      &info, &length) == 0)
+  {
+    return info.tcpi_last_data_recv;
+  }
+#else
+  (void)socket;
+#endif
+  return 0;
+}
+
 connection::connection(boost::asio::ip::tcp::socket socket,
     connection_manager& manager, request_handler& handler)
   : socket_(std::move(socket)),
     connection_manager_(manager),
-    request_handler_(handler)
+    request_handler_(handler),
+    request_started_(false)
 {
 }
 
@@ -44,13 +69,25 @@ void connection::do_read()
       {
         if (!ec)
         {
+          // This handler only runs once the io thread is free, which can be
+          // long after the bytes arrived if another connection's request was
+          // being handled. Start the clock from when the kernel got them so
+          // that the time spent queued counts too.
+          if (!request_started_)
+          {
+            request_started_ = true;
+            Clock::time_point arrived = Clock::now()
+                - std::chrono::milliseconds(queued_millis(socket_));
+            deadline_ = Deadline::after(arrived, Dispatcher::moveBudgetMillis);
+          }
+
           request_parser::result_type result;
           std::tie(result, std::ignore) = request_parser_.parse(
               request_, buffer_.data(), buffer_.data() + bytes_transferred);
 
           if (result == request_parser::good)
           {
-            request_handler_.handle_request(request_, reply_);
+            request_handler_.handle_request(request_, reply_, deadline_);
             do_write();
           }
           else if (result == request_parser::bad)
@@ -462,16 +499,21 @@ request_handler::request_handler(const std::string& doc_root)
 {
 }
 
-void request_handler::handle_request(const request& req, reply& rep)
+void request_handler::handle_request(
+    const request& req, reply& rep, Deadline deadline)
 {
     if (req.uri == "/move")
     {
-        rep.content = Dispatcher::move(req.body);
+        rep.content = Dispatcher::move(req.body, deadline);
     }
     else if (req.uri == "/start")
     {
         rep.content = Dispatcher::start(req.body);
     }
+    else if (req.uri == "/metrics")
+    {
+        rep.content = Dispatcher::metrics();
+    }
     else
     {
         rep.content = "{ error: \"wat\" }";
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "timing.hpp"
+
 //
 // header.hpp
 // ~~~~~~~~~~
@@ -288,7 +290,7 @@ public:
   explicit request_handler(const std::string& doc_root);
 
   /// Handle a request and produce a reply.
-  void handle_request(const request& req, reply& rep);
+  void handle_request(const request& req, reply& rep, Deadline deadline);
 
 private:
   /// The directory containing the files to be served.
@@ -469,6 +471,13 @@ private:
 
   /// The reply to be sent back to the client.
   reply reply_;
+
+  /// When the reply has to be sent by. Counted from when the kernel received
+  /// the request (as of the first read) rather than from when it got read.
+  Deadline deadline_;
+
+  /// Whether any of the current request has been read yet.
+  bool request_started_;
 };
 
 typedef std::shared_ptr<connection> connection_ptr;